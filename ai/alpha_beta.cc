@@ -0,0 +1,316 @@
+#include "ai/alpha_beta.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "ai/evaluation.h"
+#include "game/board.h"
+
+namespace santorini {
+namespace {
+
+constexpr int kInfinity = kWinScore + 1;
+
+// Scores beyond this are wins or losses a known number of plies away.
+constexpr int kMateThreshold = kWinScore - 1000;
+
+// How often, in nodes, to check the clock.
+constexpr int64_t kTimeCheckInterval = 1024;
+
+// Scores of won positions depend on the distance from the root, so that the
+// search prefers faster wins. In the transposition table they are stored
+// relative to the position itself.
+int ScoreToTT(int score, int ply) {
+  if (score > kMateThreshold) return score + ply;
+  if (score < -kMateThreshold) return score - ply;
+  return score;
+}
+
+int ScoreFromTT(int score, int ply) {
+  if (score > kMateThreshold) return score - ply;
+  if (score < -kMateThreshold) return score + ply;
+  return score;
+}
+
+}  // namespace
+
+// The search run by each thread. Threads share only the transposition table
+// and the stop flag.
+class AlphaBetaAI::SearchThread {
+ public:
+  SearchThread(int thread_id, const AlphaBetaOptions& options,
+               absl::Time deadline, TranspositionTable* tt,
+               std::atomic<bool>* stop)
+      : thread_id_(thread_id),
+        options_(options),
+        deadline_(deadline),
+        tt_(tt),
+        stop_(stop) {
+    std::fill(&killers_[0][0], &killers_[0][0] + kMaxPly * 2, -1);
+    // Helper threads break ties between moves differently, so that they
+    // don't just repeat the work of the main thread.
+    for (int player : {0, 1}) {
+      for (int move = 0; move < 128; ++move) {
+        history_[player][move] =
+            thread_id == 0 ? 0 : ((move + 1) * 2654435761u * thread_id) >> 28;
+      }
+    }
+  }
+
+  // Runs iterative deepening from `board`. Helper threads start at depth 2
+  // on every other thread. The main thread sets the stop flag when it is
+  // done.
+  void Run(const Board& board) {
+    Board search_board = board;
+    if (options_.nnue != nullptr) {
+      options_.nnue->Refresh(board, &accumulators_[0]);
+    }
+    const int start_depth = 1 + thread_id_ % 2;
+    for (int depth = start_depth; depth <= options_.max_depth; ++depth) {
+      root_move_ = -1;
+      const int score =
+          Search(&search_board, depth, /*ply=*/0, -kInfinity, kInfinity);
+      if (aborted_) break;
+      CHECK_NE(root_move_, -1);
+      best_move_ = root_move_;
+      completed_depth_ = depth;
+      score_ = score;
+      VLOG(1) << "alpha-beta thread " << thread_id_ << " depth " << depth
+              << " score " << score << " move " << MoveDebugString(best_move_)
+              << " nodes " << nodes_;
+      // No point in searching deeper once the result is decided.
+      if (std::abs(score) > kMateThreshold) break;
+    }
+    if (thread_id_ == 0) {
+      stop_->store(true, std::memory_order_relaxed);
+    }
+  }
+
+  int best_move() const { return best_move_; }
+  int completed_depth() const { return completed_depth_; }
+  int score() const { return score_; }
+  int64_t nodes() const { return nodes_; }
+
+ private:
+  // The maximum number of plies from the root.
+  static constexpr int kMaxPly = 64;
+
+  // Returns the negamax score of `board` from the point of view of the player
+  // to move, searching `depth` more plies. `ply` is the distance from the
+  // root. At the root, sets root_move_ to the best move.
+  int Search(Board* board, int depth, int ply, int alpha, int beta);
+
+  // Sorts `moves` so that the most promising are searched first.
+  void OrderMoves(int ply, int tt_move, int player,
+                  std::vector<Board::Move>* moves);
+
+  const int thread_id_;
+  const AlphaBetaOptions& options_;
+  const absl::Time deadline_;
+  TranspositionTable* tt_;
+  std::atomic<bool>* stop_;
+
+  // Moves that caused a beta cutoff, by ply.
+  int killers_[kMaxPly][2];
+  // Bonus for moves that caused a beta cutoff, by player and move.
+  int history_[2][128];
+  // Move lists, by ply, reused to avoid allocating during search.
+  std::vector<Board::Move> moves_[kMaxPly];
+  int move_scores_[128];
+  // With an NNUE, the accumulator of the position at each ply.
+  Nnue::Accumulator accumulators_[kMaxPly + 1];
+
+  bool aborted_ = false;
+  int64_t nodes_ = 0;
+  int root_move_ = -1;
+  int best_move_ = -1;
+  int completed_depth_ = 0;
+  int score_ = 0;
+};
+
+void AlphaBetaAI::SearchThread::OrderMoves(int ply, int tt_move, int player,
+                                           std::vector<Board::Move>* moves) {
+  for (const Board::Move& move : *moves) {
+    int score = history_[player][move.move_id];
+    if (move.move_id == tt_move) {
+      score = 1 << 30;
+    } else if (move.is_winning) {
+      score = 1 << 29;
+    } else if (move.move_id == killers_[ply][0]) {
+      score = 1 << 28;
+    } else if (move.move_id == killers_[ply][1]) {
+      score = 1 << 27;
+    }
+    move_scores_[move.move_id] = score;
+  }
+  std::stable_sort(moves->begin(), moves->end(),
+                   [this](const Board::Move& a, const Board::Move& b) {
+                     return move_scores_[a.move_id] > move_scores_[b.move_id];
+                   });
+}
+
+int AlphaBetaAI::SearchThread::Search(Board* board, int depth, int ply,
+                                      int alpha, int beta) {
+  ++nodes_;
+  if (nodes_ % kTimeCheckInterval == 0 &&
+      options_.max_time > absl::ZeroDuration() && absl::Now() >= deadline_) {
+    stop_->store(true, std::memory_order_relaxed);
+  }
+  if (stop_->load(std::memory_order_relaxed)) aborted_ = true;
+  if (aborted_) return 0;
+
+  // The previous move won the game.
+  if (board->winner() != -1) return -(kWinScore - ply);
+
+  if (depth == 0) {
+    if (options_.nnue != nullptr) {
+      return options_.nnue->Evaluate(accumulators_[ply],
+                                     board->current_player());
+    }
+    const int score = Evaluate(*board, board->current_player());
+    if (score <= -kWinScore) return -(kWinScore - ply);
+    if (score >= kWinScore) return kWinScore - ply - 1;
+    return score;
+  }
+
+  const uint64_t key = board->hash();
+  int tt_move = -1;
+  TTEntry entry;
+  if (options_.use_transposition_table && tt_->Probe(key, &entry)) {
+    tt_move = entry.move;
+    if (ply > 0 && entry.depth >= depth) {
+      const int score = ScoreFromTT(entry.score, ply);
+      if (entry.bound == Bound::kExact ||
+          (entry.bound == Bound::kLower && score >= beta) ||
+          (entry.bound == Bound::kUpper && score <= alpha)) {
+        return score;
+      }
+    }
+  }
+
+  std::vector<Board::Move>& moves = moves_[ply];
+  board->PossibleMoves(&moves);
+  // A player without moves loses.
+  if (moves.empty()) return -(kWinScore - ply);
+
+  // Take a win in one right away.
+  for (const Board::Move& move : moves) {
+    if (move.is_winning) {
+      if (ply == 0) root_move_ = move.move_id;
+      return kWinScore - ply - 1;
+    }
+  }
+
+  const int player = board->current_player();
+  OrderMoves(ply, tt_move, player, &moves);
+
+  const int original_alpha = alpha;
+  int best_score = -kInfinity;
+  int best_move = -1;
+  for (const Board::Move& move : moves) {
+    if (options_.nnue != nullptr) {
+      options_.nnue->Update(*board, move.move_id, accumulators_[ply],
+                            &accumulators_[ply + 1]);
+    }
+    CHECK(board->MakeMove(move.move_id));
+    const int score = -Search(board, depth - 1, ply + 1, -beta, -alpha);
+    board->UnmakeMove();
+    if (aborted_) return 0;
+
+    if (score > best_score) {
+      best_score = score;
+      best_move = move.move_id;
+      if (ply == 0) root_move_ = best_move;
+    }
+    if (score > alpha) alpha = score;
+    if (alpha >= beta) {
+      if (move.move_id != killers_[ply][0]) {
+        killers_[ply][1] = killers_[ply][0];
+        killers_[ply][0] = move.move_id;
+      }
+      history_[player][move.move_id] += depth * depth;
+      break;
+    }
+  }
+
+  Bound bound = Bound::kExact;
+  if (best_score <= original_alpha) {
+    bound = Bound::kUpper;
+  } else if (best_score >= beta) {
+    bound = Bound::kLower;
+  }
+  if (options_.use_transposition_table) {
+    tt_->Store(key, depth, ScoreToTT(best_score, ply), bound, best_move);
+  }
+  return best_score;
+}
+
+AlphaBetaAI::AlphaBetaAI(int player_id, const AlphaBetaOptions& options)
+    : player_id_(player_id),
+      options_(options),
+      tt_(options.transposition_table_bits) {
+  CHECK_GE(options_.max_depth, 1);
+  CHECK_LT(options_.max_depth, 64);
+  CHECK_GE(options_.num_threads, 1);
+}
+
+AlphaBetaAI::~AlphaBetaAI() {}
+
+int AlphaBetaAI::SelectMove(const Board& board) {
+  CHECK_EQ(board.current_player(), player_id_);
+  const absl::Time deadline = absl::Now() + options_.max_time;
+  std::atomic<bool> stop(false);
+
+  std::vector<std::unique_ptr<SearchThread>> searches;
+  for (int i = 0; i < options_.num_threads; ++i) {
+    searches.push_back(
+        std::make_unique<SearchThread>(i, options_, deadline, &tt_, &stop));
+  }
+  {
+    std::vector<std::thread> threads;
+    for (int i = 1; i < options_.num_threads; ++i) {
+      threads.emplace_back([&, i]() { searches[i]->Run(board); });
+    }
+    searches[0]->Run(board);
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // Play the move of the deepest completed search, preferring the main
+  // thread on ties.
+  stats_ = {};
+  const SearchThread* best = nullptr;
+  for (const auto& search : searches) {
+    stats_.nodes += search->nodes();
+    if (search->best_move() == -1) continue;
+    if (best == nullptr ||
+        search->completed_depth() > best->completed_depth()) {
+      best = search.get();
+    }
+  }
+
+  int best_move = -1;
+  if (best != nullptr) {
+    best_move = best->best_move();
+    stats_.depth = best->completed_depth();
+    stats_.score = best->score();
+  } else {
+    // If even the first iteration ran out of time, play any move.
+    best_move = board.PossibleMoves().front().move_id;
+  }
+
+  VLOG(0) << "player " << player_id_ << " alpha-beta score = " << stats_.score
+          << " at depth " << stats_.depth << " (" << stats_.nodes
+          << " nodes)";
+  return best_move;
+}
+
+}  // namespace santorini
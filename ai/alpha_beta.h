@@ -0,0 +1,79 @@
+#ifndef SANTORINI_AI_ALPHA_BETA_H_
+#define SANTORINI_AI_ALPHA_BETA_H_
+
+#include <cstdint>
+
+#include "absl/time/time.h"
+#include "ai/nnue.h"
+#include "ai/transposition_table.h"
+#include "game/board.h"
+#include "game/player.h"
+
+namespace santorini {
+
+struct AlphaBetaOptions {
+  // The maximum depth, in plies, of the iterative deepening search.
+  int max_depth = 8;
+
+  // If positive, the search stops after this much wall time and plays the
+  // best move of the deepest completed iteration.
+  absl::Duration max_time = absl::ZeroDuration();
+
+  // The transposition table has 2^transposition_table_bits entries.
+  int transposition_table_bits = 20;
+
+  // If false, the transposition table is not used. For tests.
+  bool use_transposition_table = true;
+
+  // The number of search threads. Threads search the same root with Lazy
+  // SMP: they share only the transposition table, and helper threads start
+  // at different depths and perturb their move ordering, so that they fill
+  // the table with results the other threads will need.
+  int num_threads = 1;
+
+  // If set, leaves are scored with this network, updated incrementally
+  // along the search path, instead of with Evaluate(). It must outlive the
+  // player.
+  const Nnue* nnue = nullptr;
+};
+
+// Statistics about the last search run by AlphaBetaAI::SelectMove.
+struct AlphaBetaStats {
+  // The depth of the deepest completed iteration.
+  int depth = 0;
+
+  // The score of the selected move, from the point of view of the player
+  // making it.
+  int score = 0;
+
+  // The number of nodes searched over all iterations and threads.
+  int64_t nodes = 0;
+};
+
+// An AI player that uses a negamax alpha-beta search with iterative
+// deepening, a transposition table, and the static evaluation from
+// ai/evaluation.h (or an NNUE) at the leaves.
+//
+// Moves are ordered by: the transposition table move, winning moves, killer
+// moves, and then the history heuristic.
+class AlphaBetaAI : public Player {
+ public:
+  AlphaBetaAI(int player_id, const AlphaBetaOptions& options = {});
+  ~AlphaBetaAI();
+
+  int SelectMove(const Board& board) override;
+
+  const AlphaBetaStats& last_search_stats() const { return stats_; }
+
+ private:
+  class SearchThread;
+
+  int player_id_;
+  AlphaBetaOptions options_;
+  TranspositionTable tt_;
+  AlphaBetaStats stats_;
+};
+
+}  // namespace santorini
+
+#endif
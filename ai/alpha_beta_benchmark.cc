@@ -0,0 +1,74 @@
+// Measures the time-to-depth speedup of Lazy SMP in AlphaBetaAI.
+//
+// To run the benchmark:
+//   $ bazel run -c opt ai:alpha_beta_benchmark
+//
+// The arguments are the number of search threads, doubling up to the number
+// of cores, and the game phase of the positions, see
+// game/benchmark_positions.h. Each benchmark iteration searches a sample of
+// the corpus positions of that phase to a fixed depth with a fresh
+// transposition table. The reported counters are:
+//   speedup  -- time-to-depth with one thread divided by this time.
+//   nodes/s  -- nodes searched per second, over all threads.
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "ai/alpha_beta.h"
+#include "benchmark/benchmark.h"
+#include "game/benchmark_positions.h"
+#include "game/board.h"
+
+namespace santorini {
+namespace {
+
+constexpr int kDepth = 6;
+constexpr int kPositionsPerPhase = 4;
+
+static void BM_TimeToDepth(benchmark::State& state) {
+  static double single_thread_seconds[kNumGamePhases] = {};
+  const int num_threads = state.range(0);
+  const GamePhase phase = static_cast<GamePhase>(state.range(1));
+  const std::vector<Board> boards =
+      BenchmarkPositions(phase, kPositionsPerPhase);
+
+  int64_t nodes = 0;
+  double seconds = 0;
+  for (auto _ : state) {
+    const auto start = std::chrono::steady_clock::now();
+    for (const Board& board : boards) {
+      AlphaBetaAI ai(board.current_player(),
+                     AlphaBetaOptions{.max_depth = kDepth,
+                                      .num_threads = num_threads});
+      benchmark::DoNotOptimize(ai.SelectMove(board));
+      nodes += ai.last_search_stats().nodes;
+    }
+    seconds += std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+  }
+
+  // Benchmarks run in order of registration, so one thread comes first.
+  seconds /= state.iterations();
+  double& baseline = single_thread_seconds[state.range(1)];
+  if (num_threads == 1) baseline = seconds;
+  if (baseline > 0) state.counters["speedup"] = baseline / seconds;
+  state.SetLabel(GamePhaseName(phase));
+  state.counters["nodes/s"] =
+      benchmark::Counter(nodes, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_TimeToDepth)
+    ->ArgsProduct({benchmark::CreateRange(
+                       1, std::max(1u, std::thread::hardware_concurrency()),
+                       /*multi=*/2),
+                   benchmark::CreateDenseRange(0, kNumGamePhases - 1,
+                                               /*step=*/1)})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace santorini
+
+BENCHMARK_MAIN();
@@ -0,0 +1,172 @@
+#include "ai/alpha_beta.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "ai/evaluation.h"
+#include "ai/nnue.h"
+#include "ai/tactics.h"
+#include "game/board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+namespace {
+
+// Player 0 can climb to level 3.
+constexpr char kWinInOne[] = "11420/342A40/130a30/10B434/41210b 0";
+
+// Player 0 can't climb to level 3, but can leave player 1 without moves.
+constexpr char kTrap[] = "22321/40A433/44130B/43444/11a331b 0";
+
+// Player 0 wins on their second move, whatever player 1 does.
+constexpr char kWinInThree[][40] = {
+    "0A1a220/34140/13030/10B433/30110b 0",
+    "01A220/141a40/1B3030/10433/10110b 0",
+};
+
+// Every move of player 1 lets player 0 climb to level 3.
+constexpr char kLossInTwo[] = "11420/342A40/130a30/10B433/4121b0 1";
+
+// Positions without a forced result within a few plies.
+constexpr char kQuiet[][40] = {
+    "00000/00A00a0/00000/00B00b0/00000 0",
+    "0A2b1a11/04201/001B00/01010/10000 0",
+    "00000/01001/010A00/0B3311/130b2a0 1",
+    "1040a1/32A000/0000B0/01211/0011b1 1",
+};
+
+struct Result {
+  int move;
+  AlphaBetaStats stats;
+};
+
+Result Search(const Board& board, const AlphaBetaOptions& options) {
+  AlphaBetaAI ai(board.current_player(), options);
+  Result result;
+  result.move = ai.SelectMove(board);
+  result.stats = ai.last_search_stats();
+  return result;
+}
+
+TEST(AlphaBetaTest, WinInOne) {
+  const Board board(kWinInOne);
+  const Result result = Search(board, {});
+  EXPECT_EQ(result.stats.score, kWinScore - 1);
+  Board after = board;
+  ASSERT_TRUE(after.MakeMove(result.move));
+  EXPECT_EQ(after.winner(), 0);
+}
+
+TEST(AlphaBetaTest, LeavingTheOpponentWithoutMovesWinsInOne) {
+  const Board board(kTrap);
+  const Result result = Search(board, {});
+  EXPECT_EQ(result.stats.score, kWinScore - 1);
+  Board after = board;
+  ASSERT_TRUE(after.MakeMove(result.move));
+  EXPECT_TRUE(after.PossibleMoves().empty());
+}
+
+TEST(AlphaBetaTest, WinInThree) {
+  for (const char* notation : kWinInThree) {
+    const Board board(notation);
+    const Result result = Search(board, {});
+    EXPECT_EQ(result.stats.score, kWinScore - 3) << notation;
+    EXPECT_EQ(result.stats.depth, 3) << notation;
+    // Every reply of the opponent leaves us a win.
+    Board after = board;
+    ASSERT_TRUE(after.MakeMove(result.move));
+    EXPECT_EQ(SolveShallow(&after, 2), TacticalResult::kLoss) << notation;
+  }
+}
+
+TEST(AlphaBetaTest, LossInTwo) {
+  const Board board(kLossInTwo);
+  const Result result = Search(board, {});
+  EXPECT_EQ(result.stats.score, -(kWinScore - 2));
+}
+
+TEST(AlphaBetaTest, SameScoreWithoutTranspositionTable) {
+  std::vector<const char*> positions = {kWinInOne, kTrap, kLossInTwo};
+  for (const char* notation : kWinInThree) positions.push_back(notation);
+  for (const char* notation : kQuiet) positions.push_back(notation);
+  for (const char* notation : positions) {
+    const Board board(notation);
+    AlphaBetaOptions options;
+    options.max_depth = 4;
+    const Result with_table = Search(board, options);
+    options.use_transposition_table = false;
+    const Result without_table = Search(board, options);
+    EXPECT_EQ(with_table.stats.score, without_table.stats.score) << notation;
+    EXPECT_EQ(with_table.stats.depth, without_table.stats.depth) << notation;
+    // The table only saves work.
+    EXPECT_LE(with_table.stats.nodes, without_table.stats.nodes) << notation;
+  }
+}
+
+TEST(AlphaBetaTest, LazySmpFindsWins) {
+  std::vector<const char*> positions = {kWinInOne, kTrap};
+  for (const char* notation : kWinInThree) positions.push_back(notation);
+  for (int num_threads : {2, 4}) {
+    for (const char* notation : positions) {
+      const Board board(notation);
+      AlphaBetaOptions options;
+      options.num_threads = num_threads;
+      const Result result = Search(board, options);
+      EXPECT_GE(result.stats.score, kWinScore - 3)
+          << notation << " on " << num_threads << " threads";
+      // The move keeps the win: the opponent is lost within two plies.
+      Board after = board;
+      ASSERT_TRUE(after.MakeMove(result.move));
+      if (after.winner() == -1) {
+        EXPECT_EQ(SolveShallow(&after, 2), TacticalResult::kLoss)
+            << notation << " on " << num_threads << " threads";
+      }
+    }
+  }
+}
+
+TEST(AlphaBetaTest, NnueFindsWins) {
+  const Nnue nnue;
+  AlphaBetaOptions options;
+  options.nnue = &nnue;
+  for (const char* notation : {kWinInOne, kTrap}) {
+    const Board board(notation);
+    const Result result = Search(board, options);
+    EXPECT_EQ(result.stats.score, kWinScore - 1) << notation;
+  }
+  for (const char* notation : kWinInThree) {
+    const Board board(notation);
+    const Result result = Search(board, options);
+    EXPECT_EQ(result.stats.score, kWinScore - 3) << notation;
+    Board after = board;
+    ASSERT_TRUE(after.MakeMove(result.move));
+    EXPECT_EQ(SolveShallow(&after, 2), TacticalResult::kLoss) << notation;
+  }
+  const Result loss = Search(Board(kLossInTwo), options);
+  EXPECT_EQ(loss.stats.score, -(kWinScore - 2));
+}
+
+// With the accumulators updated along the search path, a depth 1 search
+// scores each move as the network does on the position after it.
+TEST(AlphaBetaTest, NnueScoresLeaves) {
+  const Nnue nnue;
+  AlphaBetaOptions options;
+  options.nnue = &nnue;
+  options.max_depth = 1;
+  for (const char* notation : kQuiet) {
+    const Board board(notation);
+    int best = -kWinScore;
+    for (const Board::Move& move : board.PossibleMoves()) {
+      Board after = board;
+      ASSERT_TRUE(after.MakeMove(move.move_id));
+      Nnue::Accumulator accumulator;
+      nnue.Refresh(after, &accumulator);
+      best = std::max(best,
+                      -nnue.Evaluate(accumulator, after.current_player()));
+    }
+    EXPECT_EQ(Search(board, options).stats.score, best) << notation;
+  }
+}
+
+}  // namespace
+}  // namespace santorini
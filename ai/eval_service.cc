@@ -0,0 +1,93 @@
+#include "ai/eval_service.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/time/time.h"
+#include "ai/network.h"
+#include "game/board.h"
+
+namespace santorini {
+
+EvalService::EvalService(const Network* network,
+                         const EvalServiceOptions& options)
+    : network_(network), options_(options) {
+  CHECK(network_ != nullptr);
+  CHECK_GE(options_.max_batch_size, 1);
+  pending_.reserve(options_.max_batch_size);
+  pending_features_.reserve(options_.max_batch_size * kNumFeatures);
+}
+
+void EvalService::Evaluate(const Board& board, NetworkOutput* output) {
+  float features[kNumFeatures];
+  EncodeBoard(board, features);
+
+  Request request;
+  request.output = output;
+  const auto deadline = std::chrono::steady_clock::now() +
+                        absl::ToChronoNanoseconds(options_.max_wait);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  pending_.push_back(&request);
+  pending_features_.insert(pending_features_.end(), features,
+                           features + kNumFeatures);
+  if (pending_.size() >= static_cast<size_t>(options_.max_batch_size)) {
+    RunBatch(&lock);
+  }
+  while (!request.done) {
+    // Once the request is part of a running batch, just wait for it.
+    if (request.taken) {
+      done_.wait(lock);
+    } else if (done_.wait_until(lock, deadline) == std::cv_status::timeout &&
+               !request.taken) {
+      RunBatch(&lock);
+    }
+  }
+}
+
+void EvalService::RunBatch(std::unique_lock<std::mutex>* lock) {
+  std::unique_ptr<Batch> batch;
+  if (free_batches_.empty()) {
+    batch = std::make_unique<Batch>();
+  } else {
+    batch = std::move(free_batches_.back());
+    free_batches_.pop_back();
+  }
+  // Take the pending requests, and leave the batch's empty buffers, which
+  // keep their capacity, for the next ones.
+  batch->requests.swap(pending_);
+  batch->features.swap(pending_features_);
+  pending_.clear();
+  pending_features_.clear();
+  pending_.reserve(options_.max_batch_size);
+  pending_features_.reserve(options_.max_batch_size * kNumFeatures);
+  const int batch_size = batch->requests.size();
+  for (Request* request : batch->requests) {
+    request->taken = true;
+  }
+  ++stats_.batches;
+  stats_.evaluations += batch_size;
+  batch->outputs.resize(batch_size);
+
+  lock->unlock();
+  network_->EvaluateBatch(batch->features.data(), batch_size,
+                          batch->outputs.data());
+  lock->lock();
+
+  for (int i = 0; i < batch_size; ++i) {
+    *batch->requests[i]->output = batch->outputs[i];
+    batch->requests[i]->done = true;
+  }
+  free_batches_.push_back(std::move(batch));
+  done_.notify_all();
+}
+
+EvalServiceStats EvalService::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}  // namespace santorini
@@ -0,0 +1,82 @@
+#ifndef SANTORINI_AI_EVAL_SERVICE_H_
+#define SANTORINI_AI_EVAL_SERVICE_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "ai/network.h"
+#include "game/board.h"
+
+namespace santorini {
+
+struct EvalServiceOptions {
+  // Evaluations are run as soon as this many are waiting.
+  int max_batch_size = 16;
+
+  // A smaller batch is run once its oldest evaluation has waited this long.
+  // Keep this short: a search thread is idle while it waits.
+  absl::Duration max_wait = absl::Microseconds(200);
+};
+
+struct EvalServiceStats {
+  int64_t evaluations = 0;
+  int64_t batches = 0;
+};
+
+// Gathers network evaluations from many search threads, and from many games,
+// into batches, so that each weight row is loaded once per batch rather than
+// once per position.
+//
+// There is no service thread: the caller that fills a batch, or whose wait
+// runs out first, runs the whole batch on behalf of the others. Callers block
+// until their result is ready, so MCTS should use virtual loss to keep its
+// threads from waiting on the same leaf.
+class EvalService {
+ public:
+  explicit EvalService(const Network* network,
+                       const EvalServiceOptions& options = {});
+
+  // Evaluates `board`, as Network::Evaluate. Thread-safe.
+  void Evaluate(const Board& board, NetworkOutput* output);
+
+  const Network& network() const { return *network_; }
+  EvalServiceStats stats() const;
+
+ private:
+  struct Request {
+    NetworkOutput* output = nullptr;
+    bool taken = false;
+    bool done = false;
+  };
+
+  // The buffers of a running batch. They are kept once the batch is done,
+  // and reused by later batches, so that running a batch doesn't allocate.
+  struct Batch {
+    std::vector<Request*> requests;
+    std::vector<float> features;
+    std::vector<NetworkOutput> outputs;
+  };
+
+  // Runs all pending requests. Requires `lock`, which is released while the
+  // network runs.
+  void RunBatch(std::unique_lock<std::mutex>* lock);
+
+  const Network* network_;
+  EvalServiceOptions options_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable done_;
+  std::vector<Request*> pending_;
+  std::vector<float> pending_features_;
+  // Batches that aren't running, one for each batch that ran at once.
+  std::vector<std::unique_ptr<Batch>> free_batches_;
+  EvalServiceStats stats_;
+};
+
+}  // namespace santorini
+
+#endif
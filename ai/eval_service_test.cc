@@ -0,0 +1,132 @@
+#include "ai/eval_service.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ai/mcts.h"
+#include "ai/network.h"
+#include "game/benchmark_positions.h"
+#include "game/board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+namespace {
+
+// A middle game position.
+constexpr char kMidgame[] = "0A2b1a11/04201/001B00/01010/10000 0";
+
+// Checks the visits of `node` and the nodes below it, after a search whose
+// threads evaluated leaves concurrently. Each visit of a node passes on to
+// one of its children, except for the visit that evaluated it, and for those
+// of other threads that evaluated it at the same time. The root is expanded
+// without being evaluated. Virtual loss that wasn't taken back would show up
+// as extra visits.
+void CheckVisits(const Node& node, int num_threads) {
+  int child_visits = 0;
+  for (const std::shared_ptr<Node>& child : node.children) {
+    child_visits += child->visits;
+    CheckVisits(*child, num_threads);
+  }
+  EXPECT_GE(node.wins, 0) << node.DebugString();
+  EXPECT_LE(node.wins, node.visits) << node.DebugString();
+  // Proven nodes are scored without passing visits on.
+  if (node.terminal_win || node.proven_winner != -1) return;
+  const bool evaluated = node.expanded && node.parent != nullptr;
+  EXPECT_GE(node.visits - child_visits, evaluated ? 1 : 0)
+      << node.DebugString();
+  EXPECT_LE(node.visits - child_visits, num_threads) << node.DebugString();
+}
+
+TEST(EvalServiceTest, MatchesNetworkEvaluate) {
+  const Network network(NetworkShape{.hidden_size = 16});
+  EvalService service(&network, EvalServiceOptions{.max_batch_size = 4});
+  const std::vector<Board> boards =
+      BenchmarkPositions(GamePhase::kMidgame, /*count=*/64);
+  constexpr int kNumThreads = 8;
+  std::vector<NetworkOutput> outputs(boards.size());
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kNumThreads; ++thread) {
+    threads.emplace_back([&, thread]() {
+      for (size_t i = thread; i < boards.size(); i += kNumThreads) {
+        service.Evaluate(boards[i], &outputs[i]);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < boards.size(); ++i) {
+    NetworkOutput expected;
+    network.Evaluate(boards[i], &expected);
+    EXPECT_FLOAT_EQ(outputs[i].value, expected.value);
+    for (int move = 0; move < kNumPolicyOutputs; ++move) {
+      EXPECT_FLOAT_EQ(outputs[i].policy[move], expected.policy[move]);
+    }
+  }
+  EXPECT_EQ(service.stats().evaluations, boards.size());
+}
+
+TEST(EvalServiceTest, FullBatchRunsOnce) {
+  const Network network(NetworkShape{.hidden_size = 16});
+  // The wait is long enough that only filling the batch can run it.
+  EvalService service(&network,
+                      EvalServiceOptions{.max_batch_size = 4,
+                                         .max_wait = absl::Seconds(60)});
+  const Board board(kMidgame);
+  NetworkOutput outputs[4];
+  std::vector<std::thread> threads;
+  for (NetworkOutput& output : outputs) {
+    threads.emplace_back([&]() { service.Evaluate(board, &output); });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(service.stats().batches, 1);
+  EXPECT_EQ(service.stats().evaluations, 4);
+}
+
+TEST(EvalServiceTest, PartialBatchRunsAtDeadline) {
+  const Network network(NetworkShape{.hidden_size = 16});
+  const absl::Duration max_wait = absl::Milliseconds(20);
+  EvalService service(&network, EvalServiceOptions{.max_batch_size = 16,
+                                                   .max_wait = max_wait});
+  const Board board(kMidgame);
+  NetworkOutput output;
+  const absl::Time start = absl::Now();
+  service.Evaluate(board, &output);
+  EXPECT_GE(absl::Now() - start, max_wait);
+  EXPECT_EQ(service.stats().batches, 1);
+  EXPECT_EQ(service.stats().evaluations, 1);
+
+  NetworkOutput expected;
+  network.Evaluate(board, &expected);
+  EXPECT_FLOAT_EQ(output.value, expected.value);
+}
+
+TEST(EvalServiceTest, VirtualLossIsTakenBack) {
+  const Network network(NetworkShape{.hidden_size = 16});
+  EvalService service(&network);
+  constexpr int kNumThreads = 4;
+  MctsOptions options;
+  options.num_iterations = 2000;
+  options.eval_service = &service;
+  options.num_threads = kNumThreads;
+  options.virtual_loss = 1;
+  options.seed = 1;
+  const Board board(kMidgame);
+  MctsAI ai(0, options);
+  ai.SelectMove(board);
+
+  const Node& root = *ai.prev_tree();
+  EXPECT_EQ(root.visits, options.num_iterations);
+  CheckVisits(root, kNumThreads);
+  EXPECT_GT(service.stats().evaluations, 0);
+  EXPECT_LE(service.stats().evaluations, options.num_iterations);
+}
+
+}  // namespace
+}  // namespace santorini
@@ -0,0 +1,99 @@
+#include "ai/evaluation.h"
+
+#include <cmath>
+
+#include "game/board.h"
+
+namespace santorini {
+namespace {
+
+constexpr int kHeightScore = 30;
+constexpr int kMobilityScore = 4;
+constexpr int kClimbScore = 8;
+constexpr int kThreatScore = 150;
+
+// The scale of Evaluate() that corresponds to odds of e:1.
+constexpr double kLogisticScale = 120.0;
+
+struct WorkerFeatures {
+  int height = 0;
+  // Squares the workers can step to.
+  int mobility = 0;
+  // Squares one level up that the workers can step to.
+  int climbs = 0;
+  // Unoccupied level 3 squares next to a worker on level 2.
+  int threats = 0;
+};
+
+bool Occupied(const Board& board, int row, int col) {
+  for (int player : {0, 1}) {
+    for (int worker : {0, 1}) {
+      const int* w = board.worker(player, worker);
+      if (w[0] == row && w[1] == col) return true;
+    }
+  }
+  return false;
+}
+
+WorkerFeatures ComputeFeatures(const Board& board, int player) {
+  WorkerFeatures features;
+  for (int worker : {0, 1}) {
+    const int row = board.worker(player, worker)[0];
+    const int col = board.worker(player, worker)[1];
+    const int h = board.height(row, col);
+    features.height += h;
+    for (int dr = -1; dr <= 1; ++dr) {
+      for (int dc = -1; dc <= 1; ++dc) {
+        if (dr == 0 && dc == 0) continue;
+        const int r = row + dr;
+        const int c = col + dc;
+        if (r < 0 || r >= Board::kNumRows || c < 0 || c >= Board::kNumCols) {
+          continue;
+        }
+        const int nh = board.height(r, c);
+        if (nh > h + 1 || nh == 4 || Occupied(board, r, c)) continue;
+        features.mobility++;
+        if (nh == h + 1) features.climbs++;
+        if (nh == 3) features.threats++;
+      }
+    }
+  }
+  return features;
+}
+
+int Score(const WorkerFeatures& features) {
+  return kHeightScore * features.height +
+         kMobilityScore * features.mobility + kClimbScore * features.climbs +
+         kThreatScore * features.threats;
+}
+
+}  // namespace
+
+int Evaluate(const Board& board, int player) {
+  if (board.winner() != -1) {
+    return board.winner() == player ? kWinScore : -kWinScore;
+  }
+  const int opponent = 1 - player;
+  const WorkerFeatures mine = ComputeFeatures(board, player);
+  const WorkerFeatures theirs = ComputeFeatures(board, opponent);
+  if (mine.mobility == 0 && board.current_player() == player) {
+    return -kWinScore;
+  }
+  if (theirs.mobility == 0 && board.current_player() == opponent) {
+    return kWinScore;
+  }
+
+  int score = Score(mine) - Score(theirs);
+  if (board.current_player() == player && mine.threats > 0) {
+    score += kToMoveThreatScore;
+  } else if (board.current_player() == opponent && theirs.threats > 0) {
+    score -= kToMoveThreatScore;
+  }
+  return score;
+}
+
+double WinProbability(const Board& board, int player) {
+  return 1.0 / (1.0 + std::exp(-Evaluate(board, player) / kLogisticScale));
+}
+
+}  // namespace santorini
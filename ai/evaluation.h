@@ -0,0 +1,28 @@
+#ifndef SANTORINI_AI_EVALUATION_H_
+#define SANTORINI_AI_EVALUATION_H_
+
+#include "game/board.h"
+
+namespace santorini {
+
+// A score that is larger than any non-terminal evaluation.
+constexpr int kWinScore = 100000;
+
+// The bonus in Evaluate() for a threat of the player to move.
+constexpr int kToMoveThreatScore = kWinScore / 2;
+
+// Returns a fast static evaluation of `board` from the point of view of
+// `player`. Positive scores favor `player`.
+//
+// The evaluation looks at worker elevation, worker mobility, and threats,
+// i.e. workers on level 2 next to an unoccupied level 3 square. A threat
+// for the player to move is a win on the next move, so it is scored close
+// to kWinScore.
+int Evaluate(const Board& board, int player);
+
+// Maps Evaluate() to an estimated probability that `player` wins.
+double WinProbability(const Board& board, int player);
+
+}  // namespace santorini
+
+#endif
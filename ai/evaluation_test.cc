@@ -0,0 +1,75 @@
+#include "ai/evaluation.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include "game/benchmark_positions.h"
+#include "game/board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+namespace {
+
+// The start position, which is the same for both players.
+constexpr char kStart[] = "00000/00A00a0/00000/00B00b0/00000 0";
+
+// Player 0 can climb to level 3.
+constexpr char kWinInOne[] = "11420/342A40/130a30/10B434/41210b 0";
+
+// The start position with player 0's first worker on levels 0 to 2, which
+// changes nothing else that Evaluate looks at.
+constexpr char kRaisedWorker[][40] = {
+    "00000/00A00a0/00000/00B00b0/00000 0",
+    "00000/01A00a0/00000/00B00b0/00000 0",
+    "00000/02A00a0/00000/00B00b0/00000 0",
+};
+
+TEST(EvaluationTest, Antisymmetric) {
+  const Board start(kStart);
+  EXPECT_EQ(Evaluate(start, 0), 0);
+  EXPECT_EQ(Evaluate(start, 1), 0);
+  for (const Board& board : BenchmarkPositions()) {
+    EXPECT_EQ(Evaluate(board, 0), -Evaluate(board, 1)) << board.ToNotation();
+  }
+}
+
+TEST(EvaluationTest, ThreatOfPlayerToMove) {
+  const Board board(kWinInOne);
+  EXPECT_GE(Evaluate(board, 0), kToMoveThreatScore);
+  EXPECT_LT(Evaluate(board, 0), kWinScore);
+  EXPECT_LE(Evaluate(board, 1), -kToMoveThreatScore);
+}
+
+TEST(EvaluationTest, HigherWorkersScoreHigher) {
+  for (size_t i = 1; i < std::size(kRaisedWorker); ++i) {
+    const Board lower(kRaisedWorker[i - 1]);
+    const Board higher(kRaisedWorker[i]);
+    EXPECT_GT(Evaluate(higher, 0), Evaluate(lower, 0)) << i;
+    EXPECT_LT(Evaluate(higher, 1), Evaluate(lower, 1)) << i;
+  }
+}
+
+TEST(EvaluationTest, WinProbability) {
+  const Board start(kStart);
+  EXPECT_DOUBLE_EQ(WinProbability(start, 0), 0.5);
+
+  std::vector<Board> boards = BenchmarkPositions();
+  std::sort(boards.begin(), boards.end(),
+            [](const Board& a, const Board& b) {
+              return Evaluate(a, 0) < Evaluate(b, 0);
+            });
+  for (size_t i = 0; i < boards.size(); ++i) {
+    const double p = WinProbability(boards[i], 0);
+    EXPECT_GE(p, 0.0);
+    EXPECT_LE(p, 1.0);
+    EXPECT_NEAR(p + WinProbability(boards[i], 1), 1.0, 1e-9);
+    if (i > 0) {
+      EXPECT_GE(p, WinProbability(boards[i - 1], 0))
+          << boards[i].ToNotation();
+    }
+  }
+}
+
+}  // namespace
+}  // namespace santorini
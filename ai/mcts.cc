@@ -1,12 +1,24 @@
 #include "ai/mcts.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
 #include <thread>
 
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/log/vlog_is_on.h"
 #include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ai/eval_service.h"
+#include "ai/evaluation.h"
+#include "ai/rollout_policy.h"
+#include "ai/tactics.h"
+#include "ai/warm_tree.h"
 #include "game/board.h"
 
 namespace santorini {
@@ -16,48 +28,101 @@ std::string Node::DebugString() const {
     return "uninitialized";
   }
 
-  const double win_rate = visits > 0 ? static_cast<float>(wins) / visits : 0.0;
-  return absl::StrFormat("t:%d, p:%d, (%.3f %d/%d), %d children, %s, tw: %d",
-                         turn, player, win_rate, wins, visits, children.size(),
-                         MoveDebugString(move), terminal_win);
+  const double win_rate = visits > 0 ? wins / visits : 0.0;
+  return absl::StrFormat(
+      "t:%d, p:%d, (%.3f %.0f/%d), amaf: %.0f/%d, %d children, %s, tw: %d",
+      turn, player, win_rate, wins, visits, amaf_wins, amaf_visits,
+      children.size(), MoveDebugString(move), terminal_win);
 }
 
 namespace {
 
+// How often, in iterations, to check whether the search can stop early.
+constexpr int kEarlyStopInterval = 256;
+
+// A search that takes over a warm tree still runs at least 1/this of
+// num_iterations, so that the cached tree keeps improving.
+constexpr int kMinWarmSearchDivisor = 4;
+
 bool ShouldExpand(const Board& board, const Node& node) {
-  if (node.terminal_win) return false;
+  if (node.terminal_win || node.proven_winner != -1) return false;
   CHECK(node.parent != nullptr);
   CHECK(!node.parent->children.empty());
   return node.parent->visits >= node.parent->children.size();
 }
 
-void ExpandNode(const Board& board, Node* node) {
-  CHECK(!node->expanded) << "Expanding a non-leaf node: "
-                         << node->DebugString();
-  node->expanded = true;
+// A cheap prior used to order moves for progressive widening. Winning moves
+// come first, followed by moves that climb the highest.
+int MovePrior(const Board& board, const Board::Move& move) {
+  if (move.is_winning) return 100;
+  const Board::MoveSquares squares = board.DecodeMove(move.move_id);
+  return board.height(squares.to_row, squares.to_col) -
+         board.height(squares.from_row, squares.from_col);
+}
 
-  // Look for possible moves, and if found, create a child for each move.
-  const std::vector<Board::Move> possible_moves = board.PossibleMoves();
-  node->children.reserve(possible_moves.size());
-  for (const auto& move : possible_moves) {
-    auto child_node = std::make_shared<Node>();
-    child_node->turn = node->turn + 1;
-    child_node->move = move.move_id;
-    child_node->player = board.current_player();
-    child_node->parent = node;
-
-    // Identify if this child node is a terminal node.
-    Board child_board = board;
-    CHECK(child_board.MakeMove(move.move_id));
-    if (child_board.winner() == child_node->player ||
-        child_board.PossibleMoves().empty()) {
-      child_node->terminal_win = true;
-    }
+// Adds a child to `node` for `move`, played by `player`.
+Node* AddChild(int player, const Board::Move& move, Node* node) {
+  auto child_node = std::make_shared<Node>();
+  child_node->turn = node->turn + 1;
+  child_node->move = move.move_id;
+  child_node->player = player;
+  child_node->parent = node;
+  // Whether the opponent is left without moves is only checked once the child
+  // is selected, see SelectNode.
+  child_node->terminal_win = move.is_winning;
+  child_node->terminal_checked = move.is_winning;
+  node->children.push_back(std::move(child_node));
+  return node->children.back().get();
+}
+
+// Returns the network's policy over `moves`, normalized with a softmax.
+std::vector<float> MovePriors(const NetworkOutput& output,
+                              const std::vector<Board::Move>& moves) {
+  std::vector<float> priors(moves.size());
+  float max_logit = -std::numeric_limits<float>::infinity();
+  for (const Board::Move& move : moves) {
+    max_logit = std::max(max_logit, output.policy[move.move_id]);
+  }
+  float total = 0;
+  for (size_t i = 0; i < moves.size(); ++i) {
+    priors[i] = std::exp(output.policy[moves[i].move_id] - max_logit);
+    total += priors[i];
+  }
+  for (float& prior : priors) {
+    prior /= total;
+  }
+  return priors;
+}
 
-    node->children.push_back(std::move(child_node));
+// Sets the priors of the children of `node`, the node for `board`, from the
+// network.
+void SetPriors(const Network& network, const Board& board, Node* node) {
+  NetworkOutput output;
+  network.Evaluate(board, &output);
+  std::vector<Board::Move> moves;
+  for (const std::shared_ptr<Node>& child : node->children) {
+    moves.push_back({.move_id = child->move});
+  }
+  const std::vector<float> priors = MovePriors(output, moves);
+  for (size_t i = 0; i < priors.size(); ++i) {
+    node->children[i]->prior = priors[i];
   }
 }
 
+// Adds children to `node` from its unexpanded moves until it has at least
+// `num_children` children, or there are no moves left.
+void WidenNode(const Board& board, size_t num_children, Node* node) {
+  while (node->children.size() < num_children &&
+         !node->unexpanded_moves.empty()) {
+    AddChild(board.current_player(), node->unexpanded_moves.back(), node);
+    node->unexpanded_moves.pop_back();
+  }
+  if (node->unexpanded_moves.empty()) {
+    node->unexpanded_moves.shrink_to_fit();
+  }
+}
+
+
 // Returns a pointer to a leaf-node in the game tree starting from `node`.
 // The `board` is modified to reflect the state as moves are made following
 // the nodes recursively down.
@@ -66,32 +131,69 @@ void ExpandNode(const Board& board, Node* node) {
 //
 // Note that this function also includes the "expansion" phase in usual
 // MCTS terminology. A leaf node is only expanded if all siblings have been
-// visited at least once. After expansion, we return a child.
-Node* SelectNode(Node* node, Board* board, double c) {
+// visited at least once. After expansion, we return a child. With a network,
+// leaves are returned unexpanded, and are expanded once evaluated.
+Node* SelectNode(Node* node, Board* board, const MctsOptions& options,
+                 std::mt19937_64* rng) {
   // If a leaf node, possibly expand it and continue selection.
   if (!node->expanded) {
-    if (!ShouldExpand(*board, *node)) {
+    if (options.network != nullptr || !ShouldExpand(*board, *node)) {
       return node;
     }
-    ExpandNode(*board, node);
+    ExpandNode(*board, options.progressive_widening, rng, node);
+  } else if (!node->unexpanded_moves.empty()) {
+    WidenNode(*board,
+              std::ceil(options.widening_c *
+                        std::pow(std::max(node->visits, 1),
+                                 options.widening_alpha)),
+              node);
   }
   CHECK(!node->children.empty());
 
-  // Pick the best child by UCB1 and recurse.
+  // Pick the best child by UCB1 (or PUCT) and recurse.
   // If any child is a guaranteed winning move, then simply select that.
   // TODO(piotrf): should terminal_win be backpropagated somehow?
   std::vector<double> ucb1(node->children.size(),
                            std::numeric_limits<double>::infinity());
   const double logN = std::log(node->visits);
+  const double sqrtN = std::sqrt(std::max(node->visits, 1));
+  // In PUCT, unvisited children are assumed to be as good as their parent.
+  const double first_play_value = node->player == -1 || node->visits == 0
+                                      ? 0.5
+                                      : 1.0 - node->wins / node->visits;
   for (size_t i = 0; i < node->children.size(); ++i) {
     Node& child = *node->children[i];
     if (child.terminal_win) {
       CHECK(board->MakeMove(child.move));
       return &child;
     }
-    if (child.visits == 0) continue;
-    ucb1[i] =
-        1.0 * child.wins / child.visits + c * std::sqrt(logN / child.visits);
+    if (options.network != nullptr) {
+      const double value =
+          child.visits > 0 ? child.wins / child.visits : first_play_value;
+      ucb1[i] =
+          value + options.puct_c * child.prior * sqrtN / (1 + child.visits);
+      continue;
+    }
+    const bool use_amaf =
+        options.rave_equivalence > 0 && child.amaf_visits > 0;
+    if (child.visits == 0) {
+      // Unvisited children are tried first, but with RAVE, those with AMAF
+      // statistics are ranked by them (beta = 1), and explored as if
+      // visited once.
+      if (use_amaf) {
+        ucb1[i] = child.amaf_wins / child.amaf_visits +
+                  options.c * std::sqrt(logN);
+      }
+      continue;
+    }
+    double value = child.wins / child.visits;
+    if (use_amaf) {
+      const double k = options.rave_equivalence;
+      const double beta = std::sqrt(k / (3 * child.visits + k));
+      value = (1 - beta) * value +
+              beta * child.amaf_wins / child.amaf_visits;
+    }
+    ucb1[i] = value + options.c * std::sqrt(logN / child.visits);
   }
 
   // If there are multiple children with the max UCB1, then select randomly.
@@ -103,81 +205,348 @@ Node* SelectNode(Node* node, Board* board, double c) {
       children_with_max.push_back(i);
     }
   }
-  int selected_child = children_with_max[rand() % children_with_max.size()];
+  Node* child =
+      node->children[children_with_max[(*rng)() % children_with_max.size()]]
+          .get();
+
+  CHECK(board->MakeMove(child->move))
+      << "SelectNode tried " << MoveDebugString(child->move);
 
-  CHECK(board->MakeMove(node->children[selected_child]->move))
-      << "SelectNode tried "
-      << MoveDebugString(node->children[selected_child]->move);
+  // Finish the deferred terminal check now that we have the child's board.
+  if (!child->terminal_checked) {
+    child->terminal_checked = true;
+    child->terminal_win = board->PossibleMoves().empty();
+  }
 
-  return SelectNode(node->children[selected_child].get(), board, c);
+  return SelectNode(child, board, options, rng);
 }
 
-int Rollout(Board board) {
-  while (board.winner() == -1) {
+// Plays out the game from `board` with moves chosen by `Policy` and returns
+// the probability that player 0 wins. This is exact unless the rollout is
+// cut short after `max_plies` moves (if positive), in which case it is
+// estimated with the static evaluation. If `minimax_depth` is positive, the
+// rollout ends as soon as a shallow search of that depth proves the result.
+// If `played` is not null, the moves made by each player are added to
+// played[player]. Random choices are drawn from `rng`.
+template <typename Policy>
+double Rollout(Board board, int max_plies, int minimax_depth,
+               std::bitset<128>* played, std::mt19937_64* rng) {
+  Policy policy(rng);
+  for (int ply = 0; board.winner() == -1; ++ply) {
+    if (max_plies > 0 && ply >= max_plies) {
+      return WinProbability(board, 0);
+    }
+    if (minimax_depth > 0) {
+      const TacticalResult result = SolveShallow(&board, minimax_depth);
+      if (result != TacticalResult::kUnknown) {
+        const bool player_0_wins =
+            (result == TacticalResult::kWin) == (board.current_player() == 0);
+        return player_0_wins ? 1.0 : 0.0;
+      }
+    }
     const std::vector<Board::Move> possible_moves = board.PossibleMoves();
     if (possible_moves.empty()) {
-      return !board.current_player();
+      return board.current_player() == 0 ? 0.0 : 1.0;
     }
-    // If there is a winning move, play that. Else, play randomly.
-    int winning_move = -1;
-    for (const auto& move : possible_moves) {
-      if (move.is_winning) {
-        winning_move = move.move_id;
-        break;
-      }
+    const int move = policy.SelectMove(board, possible_moves);
+    if (played != nullptr) {
+      played[board.current_player()].set(move);
     }
-    const int move =
-        winning_move != -1
-            ? winning_move
-            : possible_moves[rand() % possible_moves.size()].move_id;
     CHECK(board.MakeMove(move));
   }
-  return board.winner();
+  return board.winner() == 0 ? 1.0 : 0.0;
+}
+
+double Rollout(const MctsOptions& options, const Board& board,
+               std::bitset<128>* played, std::mt19937_64* rng) {
+  switch (options.rollout_policy) {
+    case RolloutPolicyType::kRandom:
+      return Rollout<RandomRolloutPolicy>(board, options.rollout_max_plies,
+                                          options.rollout_minimax_depth,
+                                          played, rng);
+    case RolloutPolicyType::kHeuristic:
+      return Rollout<HeuristicRolloutPolicy>(board, options.rollout_max_plies,
+                                             options.rollout_minimax_depth,
+                                             played, rng);
+  }
+  LOG(FATAL) << "Unknown rollout policy "
+             << static_cast<int>(options.rollout_policy);
+}
+
+// Converts the probability that player 0 wins into the wins to credit to
+// `player`. Nothing is credited to the root's unknown player.
+double PlayerWins(int player, double p0_wins) {
+  if (player == -1) return 0.0;
+  return player == 0 ? p0_wins : 1.0 - p0_wins;
+}
+
+// The bytes of a heap block that make_shared allocates for a Node: the node
+// after a control block of a vtable pointer and two 32-bit counts.
+constexpr int64_t kNodeBlockBytes = sizeof(Node) + sizeof(void*) + 8;
+
+// The bytes that glibc malloc takes for a request of `size`: an 8-byte
+// chunk header, rounded up to 16 bytes, and at least 32.
+int64_t MallocChunkBytes(int64_t size) {
+  return std::max<int64_t>(32, (size + 8 + 15) & ~int64_t{15});
+}
+
+void AddVectorMemory(int64_t capacity_bytes, TreeMemory* memory) {
+  if (capacity_bytes == 0) return;
+  memory->vector_bytes += capacity_bytes;
+  ++memory->allocations;
+  memory->allocated_bytes += MallocChunkBytes(capacity_bytes);
+}
+
+void AddTreeMemory(const Node& node, TreeMemory* memory) {
+  ++memory->nodes;
+  memory->node_bytes += kNodeBlockBytes;
+  ++memory->allocations;
+  memory->allocated_bytes += MallocChunkBytes(kNodeBlockBytes);
+  AddVectorMemory(node.children.capacity() * sizeof(node.children[0]),
+                  memory);
+  AddVectorMemory(
+      node.unexpanded_moves.capacity() * sizeof(node.unexpanded_moves[0]),
+      memory);
+  for (const std::shared_ptr<Node>& child : node.children) {
+    AddTreeMemory(*child, memory);
+  }
 }
 
 }  // namespace
 
+TreeMemory MeasureTree(const Node& root) {
+  TreeMemory memory;
+  AddTreeMemory(root, &memory);
+  return memory;
+}
+
+void ExpandNode(const Board& board, bool progressive, std::mt19937_64* rng,
+                Node* node) {
+  CHECK(!node->expanded) << "Expanding a non-leaf node: "
+                         << node->DebugString();
+  node->expanded = true;
+
+  // Look for possible moves, and if found, create a child for each move.
+  std::vector<Board::Move> possible_moves = board.PossibleMoves();
+  if (!progressive) {
+    node->children.reserve(possible_moves.size());
+    for (const auto& move : possible_moves) {
+      AddChild(board.current_player(), move, node);
+    }
+    return;
+  }
+
+  // Shuffle before sorting so that moves with an equal prior are added in a
+  // random order.
+  for (size_t i = possible_moves.size(); i > 1; --i) {
+    std::swap(possible_moves[i - 1], possible_moves[(*rng)() % i]);
+  }
+  std::stable_sort(possible_moves.begin(), possible_moves.end(),
+                   [&board](const Board::Move& a, const Board::Move& b) {
+                     return MovePrior(board, a) < MovePrior(board, b);
+                   });
+  node->unexpanded_moves = std::move(possible_moves);
+  WidenNode(board, 1, node);
+}
+
 MctsAI::MctsAI(int player_id, const MctsOptions& options)
     : player_id_(player_id),
       options_(options),
+      seed_(options.seed != -1 ? options.seed : std::random_device()()),
       tree_(std::make_shared<Node>()) {
   tree_->turn = player_id - 1;
+  if (options_.eval_service != nullptr && options_.network == nullptr) {
+    options_.network = &options_.eval_service->network();
+  }
+  CHECK(options_.network == nullptr || !options_.progressive_widening)
+      << "Progressive widening is not supported with a network.";
 }
 
 MctsAI::~MctsAI() {}
 
-void MctsAI::Iteration(Board board) {
-  // Select and possibly expand a node.
+std::unique_lock<std::mutex> MctsAI::LockTree(absl::Duration* lock_wait) {
+  // Only read the clock if the lock is contended.
+  std::unique_lock<std::mutex> lock(tree_mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    const absl::Time start = absl::Now();
+    lock.lock();
+    *lock_wait += absl::Now() - start;
+  }
+  return lock;
+}
+
+void MctsAI::Iteration(Board board, Worker* worker) {
+  // Apply the previous iteration's results, and select and possibly expand a
+  // node, all under a single lock.
   Node* node = nullptr;
+  int proven_winner = -1;
+  bool search_leaf = false;
   {
-    std::lock_guard<std::mutex> lock(tree_mutex_);
-    node = SelectNode(tree_.get(), &board, options_.c);
+    const std::unique_lock<std::mutex> lock = LockTree(&worker->lock_wait);
+    for (const RolloutResult& result : worker->results) {
+      Backpropagate(result);
+    }
+    node = SelectNode(tree_.get(), &board, options_, &worker->rng);
+    proven_winner = node->terminal_win ? node->player : node->proven_winner;
+    search_leaf = options_.leaf_minimax_depth > 0 && proven_winner == -1 &&
+                  !node->leaf_searched;
+    node->leaf_searched |= search_leaf;
+    for (Node* n = node; n != nullptr; n = n->parent) {
+      n->visits += options_.virtual_loss;
+    }
   }
+  std::vector<RolloutResult>* results = &worker->results;
+  results->clear();
 
-  // Run rollouts on the selected node.
-  for (int i = 0; i < options_.num_rollouts_per_iteration; ++i) {
-    VLOG(5) << "  MCTS running rollout " << i;
-    const int winner = Rollout(board);
-    VLOG(5) << "   rollout winner is " << winner;
+  if (search_leaf) {
+    const TacticalResult tactical =
+        SolveShallow(&board, options_.leaf_minimax_depth);
+    if (tactical == TacticalResult::kWin) {
+      proven_winner = board.current_player();
+    } else if (tactical == TacticalResult::kLoss) {
+      proven_winner = 1 - board.current_player();
+    }
+  }
 
-    if (node->terminal_win) {
-      CHECK_EQ(winner, node->player);
+  // With a network, evaluate the selected node instead of running rollouts.
+  if (options_.network != nullptr && proven_winner == -1) {
+    RolloutResult& result = results->emplace_back();
+    result.node = node;
+    board.PossibleMoves(&result.moves);
+    if (result.moves.empty()) {
+      result.p0_wins = board.current_player() == 0 ? 0.0 : 1.0;
+      result.proven_winner = 1 - board.current_player();
+    } else {
+      NetworkOutput output;
+      if (options_.eval_service != nullptr) {
+        options_.eval_service->Evaluate(board, &output);
+      } else {
+        options_.network->Evaluate(board, &output);
+      }
+      const double to_move_wins = (output.value + 1) / 2;
+      result.p0_wins =
+          board.current_player() == 0 ? to_move_wins : 1.0 - to_move_wins;
+      result.priors = MovePriors(output, result.moves);
     }
+  } else {
+    // Run rollouts on the selected node, unless its result is already
+    // known. The results are kept until the next time this worker takes the
+    // lock.
+    for (int i = 0; i < options_.num_rollouts_per_iteration; ++i) {
+      RolloutResult& result = results->emplace_back();
+      result.node = node;
+      if (proven_winner != -1) {
+        result.p0_wins = proven_winner == 0 ? 1.0 : 0.0;
+        result.proven_winner = proven_winner;
+        continue;
+      }
+      VLOG(5) << "  MCTS running rollout " << i;
+      result.p0_wins =
+          Rollout(options_, board,
+                  options_.rave_equivalence > 0 ? result.played : nullptr,
+                  &worker->rng);
+      VLOG(5) << "   rollout player 0 win probability is " << result.p0_wins;
+    }
+  }
+  results->front().virtual_loss = options_.virtual_loss;
+}
+
+void MctsAI::Backpropagate(const RolloutResult& result) {
+  // Expand an evaluated leaf, unless another thread got there first.
+  if (!result.moves.empty() && !result.node->expanded) {
+    Node* node = result.node;
+    CHECK_NE(node->player, -1);
+    node->expanded = true;
+    node->children.reserve(result.moves.size());
+    for (size_t i = 0; i < result.moves.size(); ++i) {
+      AddChild(1 - node->player, result.moves[i], node)->prior =
+          result.priors[i];
+    }
+  }
 
-    // Bookkeeping on the winner.
-    std::lock_guard<std::mutex> lock(tree_mutex_);
-    Node* update_node = node;
-    CHECK(update_node->parent != nullptr);
-    while (update_node != nullptr) {
-      update_node->visits++;
-      if (update_node->player == winner) {
-        update_node->wins++;
+  if (result.proven_winner != -1) {
+    result.node->proven_winner = result.proven_winner;
+    if (result.proven_winner == result.node->player) {
+      result.node->terminal_win = true;
+    }
+  }
+
+  std::bitset<128> played[2] = {result.played[0], result.played[1]};
+  Node* update_node = result.node;
+  CHECK(update_node->parent != nullptr);
+  while (update_node != nullptr) {
+    update_node->visits += 1 - result.virtual_loss;
+    update_node->wins += PlayerWins(update_node->player, result.p0_wins);
+    if (options_.rave_equivalence > 0) {
+      // All moves played after this node, in the tree or in the rollout,
+      // count as a visit to the sibling playing the same move.
+      for (const std::shared_ptr<Node>& child : update_node->children) {
+        if (played[child->player].test(child->move)) {
+          child->amaf_visits++;
+          child->amaf_wins += PlayerWins(child->player, result.p0_wins);
+        }
+      }
+      if (update_node->player != -1) {
+        played[update_node->player].set(update_node->move);
       }
-      update_node = update_node->parent;
     }
+    update_node = update_node->parent;
   }
 }
 
+bool MctsAI::ShouldStopEarly(int remaining_iterations, Worker* worker) {
+  if (!options_.early_stopping && options_.early_stop_confidence <= 0) {
+    return false;
+  }
+  const std::unique_lock<std::mutex> lock = LockTree(&worker->lock_wait);
+  // Apply our own deferred results, so that only other threads' can be
+  // missing from the tree.
+  for (const RolloutResult& result : worker->results) {
+    Backpropagate(result);
+  }
+  worker->results.clear();
+  const Node* best = nullptr;
+  const Node* second = nullptr;
+  for (const std::shared_ptr<Node>& child : tree_->children) {
+    if (best == nullptr || child->visits > best->visits) {
+      second = best;
+      best = child.get();
+    } else if (second == nullptr || child->visits > second->visits) {
+      second = child.get();
+    }
+  }
+  if (best == nullptr || second == nullptr) return false;
+
+  // Each remaining iteration adds at most num_rollouts_per_iteration visits
+  // to the runner-up.
+  if (options_.early_stopping &&
+      best->visits - second->visits >
+          static_cast<int64_t>(remaining_iterations) *
+              options_.num_rollouts_per_iteration) {
+    return true;
+  }
+
+  if (options_.early_stop_confidence > 0) {
+    // Compare the confidence interval of the leader's win rate against that
+    // of every other move, with add-one smoothing so that moves that always
+    // win or always lose still have some uncertainty.
+    auto bound = [&](const Node& node, double sign) {
+      const double n = node.visits + 2;
+      const double q = (node.wins + 1) / n;
+      return q + sign * options_.early_stop_confidence *
+                     std::sqrt(q * (1 - q) / n);
+    };
+    const double best_lower = bound(*best, -1.0);
+    for (const std::shared_ptr<Node>& child : tree_->children) {
+      if (child.get() != best && bound(*child, 1.0) >= best_lower) {
+        return false;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
 int MctsAI::SelectMove(const Board& board) {
   // Unless this is the first move, update tree based on the opponent's move.
   if (!board.past_moves().empty() && !tree_->children.empty()) {
@@ -195,14 +564,59 @@ int MctsAI::SelectMove(const Board& board) {
         break;
       }
     }
-    CHECK(found_match);
+    if (!found_match) {
+      // With progressive widening, the opponent may have played a move that
+      // never got a child. Start over from a fresh root.
+      CHECK(!tree_->unexpanded_moves.empty());
+      auto root = std::make_shared<Node>();
+      root->turn = tree_->turn + 1;
+      root->move = last_move;
+      root->player = board.current_player() == 0 ? 1 : 0;
+      tree_ = std::move(root);
+    }
+  }
+
+  // Play from the opening book if we can. The tree is thrown away, and the
+  // search starts over from a fresh root once we're out of the book.
+  last_search_stats_ = {};
+  BookMove book_move;
+  if (options_.opening_book != nullptr &&
+      options_.opening_book->Probe(board, &book_move)) {
+    VLOG(0) << "player " << player_id_ << " book move "
+            << MoveDebugString(book_move.move_id) << " (" << book_move.visits
+            << " visits, estimate of winning = " << book_move.win_rate << ")";
+    last_search_stats_.book_move = true;
+    last_search_stats_.root_visits = {{book_move.move_id, book_move.visits}};
+    prev_tree_ = nullptr;
+    tree_ = std::make_shared<Node>();
+    tree_->turn = board.past_moves().size() + 1;
+    return book_move.move_id;
+  }
+
+  // Take over the warm tree if it has seen this position more than we have.
+  int num_iterations = options_.num_iterations;
+  if (options_.warm_tree != nullptr) {
+    std::shared_ptr<Node> warm_tree =
+        options_.warm_tree->Checkout(board, tree_->visits);
+    if (warm_tree != nullptr) {
+      tree_ = std::move(warm_tree);
+      last_search_stats_.warm_visits = tree_->visits;
+      num_iterations =
+          std::max(options_.num_iterations / kMinWarmSearchDivisor,
+                   num_iterations - tree_->visits);
+    }
   }
 
-  // Expand out the root, in case we didn't find it above.
+  // Expand out the root, in case we didn't find it above. The root always
+  // has all of its children, so that every move is considered.
   if (!tree_->expanded) {
-    ExpandNode(board, tree_.get());
+    ExpandNode(board, /*progressive=*/false, /*rng=*/nullptr, tree_.get());
   }
+  WidenNode(board, std::numeric_limits<size_t>::max(), tree_.get());
   CHECK_GT(tree_->children.size(), 0);
+  if (options_.network != nullptr) {
+    SetPriors(*options_.network, board, tree_.get());
+  }
   VLOG(1) << "current tree_: " << tree_->DebugString();
 
   // If there is only a single move available, take it. In theory, we could
@@ -210,6 +624,7 @@ int MctsAI::SelectMove(const Board& board) {
   //   1) we're not playing in a timed environment.
   //   2) it's rare that a single move will lead to many future moves.
   if (tree_->children.size() == 1) {
+    last_search_stats_.root_visits = {{tree_->children[0]->move, 1}};
     tree_ = std::move(tree_->children[0]);
     return tree_->move;
   }
@@ -219,26 +634,62 @@ int MctsAI::SelectMove(const Board& board) {
     // Launch all worker threads.
     std::vector<std::thread> workers;
     std::atomic<int> counter(0);
+    std::atomic<bool> stop(false);
+    const uint32_t search = num_searches_++;
     for (int i = 0; i < options_.num_threads; ++i) {
-      workers.emplace_back([&]() {
-        while (true) {
-          if (counter.fetch_add(1) >= options_.num_iterations) return;
-          Iteration(board);
+      workers.emplace_back([&, i]() {
+        std::seed_seq seed{static_cast<uint32_t>(seed_),
+                           static_cast<uint32_t>(seed_ >> 32), search,
+                           static_cast<uint32_t>(i)};
+        Worker worker(seed);
+        worker.results.reserve(options_.num_rollouts_per_iteration);
+        while (!stop) {
+          const int iteration = counter.fetch_add(1);
+          if (iteration >= num_iterations) break;
+          Iteration(board, &worker);
+          if (iteration % kEarlyStopInterval != 0) continue;
+          // The iterations that may still add visits: those not claimed
+          // yet, those other threads claimed after ours, and from before
+          // ours, one in flight and one waiting in its results per other
+          // thread.
+          const int claimed = std::min(counter.load(), num_iterations);
+          const int remaining = (num_iterations - claimed) +
+                                (claimed - iteration - 1) +
+                                2 * (options_.num_threads - 1);
+          if (ShouldStopEarly(remaining, &worker)) stop = true;
         }
+        const std::unique_lock<std::mutex> lock =
+            LockTree(&worker.lock_wait);
+        for (const RolloutResult& result : worker.results) {
+          Backpropagate(result);
+        }
+        last_search_stats_.lock_wait += worker.lock_wait;
       });
     }
     // Join worker threads.
     for (std::thread& worker : workers) {
       worker.join();
     }
+    last_search_stats_.iterations = std::min(counter.load(), num_iterations);
+    last_search_stats_.iterations_saved =
+        num_iterations - last_search_stats_.iterations;
+  }
+  if (options_.warm_tree != nullptr) {
+    options_.warm_tree->Commit(board, *tree_);
+  }
+  if (last_search_stats_.iterations_saved > 0) {
+    VLOG(1) << "MCTS stopped early, saved "
+            << last_search_stats_.iterations_saved << " iterations.";
   }
 
   // Pick the best move.
   VLOG(1) << "MCTS picking from " << tree_->children.size() << " moves.";
   int max_visits = 0;
   std::shared_ptr<Node>* best_child = nullptr;
+  last_search_stats_.root_visits.reserve(tree_->children.size());
   for (std::shared_ptr<Node>& child : tree_->children) {
     VLOG(2) << child->DebugString();
+    last_search_stats_.root_visits.emplace_back(child->move, child->visits);
     if (child->visits > max_visits) {
       max_visits = child->visits;
       best_child = &child;
@@ -251,7 +702,7 @@ int MctsAI::SelectMove(const Board& board) {
   }
   CHECK(best_child != nullptr);
   VLOG(0) << "player " << player_id_ << " estimate of winning = "
-          << static_cast<double>((*best_child)->wins) / (*best_child)->visits;
+          << (*best_child)->wins / (*best_child)->visits;
   prev_tree_ = tree_;
   tree_ = *best_child;
   return tree_->move;
@@ -1,16 +1,28 @@
 #ifndef SANTORINI_AI_BLOKUS_H_
 #define SANTORINI_AI_BLOKUS_H_
 
+#include <bitset>
 #include <memory>
 #include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
 
+#include "absl/time/time.h"
+#include "ai/network.h"
+#include "ai/opening_book.h"
+#include "ai/rollout_policy.h"
 #include "game/board.h"
 #include "game/player.h"
 
 namespace santorini {
 
+class EvalService;
+class WarmTree;
+
 struct MctsOptions {
-  // The exploration parameter for UCB1.
+  // The exploration parameter for UCB1. Not used with a network, see
+  // puct_c.
   // Setting this higher favors exploration more over exploitation.
   // Theory dictates that this should be approximately sqrt(2).
   double c = 1.4;
@@ -20,11 +32,94 @@ struct MctsOptions {
   // and backpropogation of rollout results.
   int num_iterations = 10000;
 
+  // If true, stop searching once the most visited root move can't be
+  // overtaken in the iterations that remain.
+  bool early_stopping = false;
+
+  // If positive, also stop searching once the win rate of the most visited
+  // root move is higher than that of every other root move by this many
+  // standard errors. This stops much sooner than early_stopping, at the risk
+  // of missing a move that would have turned out better.
+  double early_stop_confidence = 0.0;
+
   // The number of random rollouts to run per MCTS iteration.
   int num_rollouts_per_iteration = 1;
 
+  // If positive, rollouts are stopped after this many moves, and the
+  // position is scored with the static evaluation as a win probability.
+  // Zero plays rollouts until the end of the game.
+  int rollout_max_plies = 0;
+
+  // If positive, newly reached leaves are searched this many plies deep for
+  // a forced win or loss (see ai/tactics.h). A proven leaf is scored exactly
+  // instead of with rollouts, and is never expanded. Depths of 2 to 4 are
+  // practical.
+  int leaf_minimax_depth = 0;
+
+  // If positive, every position in a rollout is searched this many plies
+  // deep for a forced win or loss, which ends the rollout. This is much more
+  // expensive than leaf_minimax_depth, so 2 is usually the most to use.
+  int rollout_minimax_depth = 0;
+
+  // The policy used to pick moves during rollouts.
+  RolloutPolicyType rollout_policy = RolloutPolicyType::kRandom;
+
   // The number of parallel threads that are running iterations.
   int num_threads = 1;
+
+  // If true, children are added to a node progressively, best prior first,
+  // rather than all at once on expansion. A node with n visits makes
+  // ceil(widening_c * n^widening_alpha) children available for selection.
+  bool progressive_widening = false;
+  double widening_c = 2.0;
+  double widening_alpha = 0.5;
+
+  // The RAVE (all-moves-as-first) equivalence parameter. A child's value is
+  // blended with its AMAF value with weight beta = sqrt(k / (3n + k)), where
+  // k is this parameter and n is the child's visit count, so AMAF statistics
+  // dominate early and fade out as real visits accumulate. Unvisited
+  // children that have AMAF statistics are ranked by them alone, rather
+  // than tried in random order. Zero disables RAVE.
+  double rave_equivalence = 0.0;
+
+  // If set, positions found in this book are played from it without
+  // searching. The book must outlive the player.
+  const OpeningBook* opening_book = nullptr;
+
+  // If set, searches start from the cached tree for the position when it has
+  // more visits than our own, and only run the iterations needed to bring
+  // the root up to num_iterations visits, but at least a quarter of them.
+  // Searched trees are committed back to the cache. The cache must outlive
+  // the player.
+  WarmTree* warm_tree = nullptr;
+
+  // If set, search AlphaZero style: leaves are scored by this network rather
+  // than by rollouts, and children are selected by PUCT, using the network's
+  // policy as their priors. Each iteration evaluates one leaf, and expands
+  // it. Can't be combined with progressive widening.
+  const Network* network = nullptr;
+
+  // The exploration parameter for PUCT. A child with prior p, n visits and
+  // win rate q scores q + puct_c * p * sqrt(N) / (1 + n), where N is the
+  // visit count of its parent.
+  double puct_c = 1.5;
+
+  // If set, network evaluations are batched with those of other threads and
+  // games through this service, and `network` defaults to its network.
+  EvalService* eval_service = nullptr;
+
+  // Visits added to every node on a selected path until its result is
+  // backpropagated, counting as losses, so that parallel threads spread out
+  // over different leaves. Mostly useful with eval_service, where threads
+  // wait on their evaluations.
+  int virtual_loss = 0;
+
+  // Seed for the random choices of the search: ties in selection, the move
+  // order of progressive widening, and rollouts. Each search thread draws
+  // from its own generator, seeded from this, the number of searches so far
+  // and the thread's index, so that a search on one thread is
+  // deterministic. If -1, the seed is random.
+  int64_t seed = -1;
 };
 
 // A node in the game tree.
@@ -45,22 +140,104 @@ struct Node {
   // The player that played the above move.
   int player = -1;
 
-  // The number of wins tracked for having made the above move.
-  int wins = 0;
+  // The number of wins tracked for having made the above move. Rollouts that
+  // are cut short add their estimated win probability, so this can be
+  // fractional.
+  double wins = 0;
 
   // The number of times rollouts have visited the above move.
   int visits = 0;
 
+  // The number of wins and visits of rollouts in which the above move was
+  // played by the same player at any later point (all-moves-as-first).
+  double amaf_wins = 0;
+  int amaf_visits = 0;
+
   // The above move is a winning move. Note that in Santorini it is impossible
-  // to make a move and lose immediately.
+  // to make a move and lose immediately. This is also set if the shallow
+  // leaf search proves that the above move forces a win.
   bool terminal_win = false;
 
+  // Whether terminal_win is final. Children are created knowing only whether
+  // their move climbs to level 3; the check for leaving the opponent without
+  // any moves is deferred until the child is first selected.
+  bool terminal_checked = false;
+
+  // The winner of the game from this node with best play, if proven by the
+  // shallow leaf search, otherwise -1.
+  int proven_winner = -1;
+
+  // Whether the shallow leaf search has been run on this node.
+  bool leaf_searched = false;
+
+  // The network's prior probability of the above move, in PUCT search.
+  float prior = 0;
+
   Node* parent = nullptr;
 
   // Children are stored as shared_ptr to make it easier to make a copy of the
   // tree. This is done for expediency, unique_ptr would make this code less bug
   // prone.
   std::vector<std::shared_ptr<Node>> children;
+
+  // With progressive widening, the moves that don't have a child yet, in
+  // increasing order of prior. The next child to add is at the back.
+  std::vector<Board::Move> unexpanded_moves;
+};
+
+// The memory held by a search tree.
+struct TreeMemory {
+  int64_t nodes = 0;
+
+  // Bytes requested for the nodes, each allocated by make_shared together
+  // with its shared_ptr control block.
+  int64_t node_bytes = 0;
+
+  // Bytes requested for the heap buffers of the nodes' vectors, by
+  // capacity.
+  int64_t vector_bytes = 0;
+
+  // The number of heap allocations, and the bytes they take from malloc,
+  // counting glibc's chunk header and rounding.
+  int64_t allocations = 0;
+  int64_t allocated_bytes = 0;
+
+  double bytes_per_node() const {
+    return nodes > 0 ? static_cast<double>(allocated_bytes) / nodes : 0.0;
+  }
+};
+
+// Walks the tree under `root`, which must not be searched meanwhile.
+TreeMemory MeasureTree(const Node& root);
+
+// Expands the leaf `node` for `board`: adds a child for every move, or with
+// `progressive` widening, orders the moves and adds only the first. Moves
+// with an equal prior are ordered with `rng`, which is only used with
+// `progressive`.
+void ExpandNode(const Board& board, bool progressive, std::mt19937_64* rng,
+                Node* node);
+
+// Statistics about the last search run by MctsAI::SelectMove.
+struct SearchStats {
+  // The number of iterations that were run.
+  int iterations = 0;
+
+  // The number of iterations skipped by stopping early.
+  int iterations_saved = 0;
+
+  // Whether the move was played from the opening book.
+  bool book_move = false;
+
+  // The root visits taken over from the warm tree, if it was used.
+  int warm_visits = 0;
+
+  // The visits of each root move, as (move_id, visits). A book move gets its
+  // book visits, and a forced move a single visit.
+  std::vector<std::pair<int, int>> root_visits;
+
+  // The time search threads spent blocked waiting for the tree lock, summed
+  // over threads.
+  absl::Duration lock_wait;
 };
 
 // An AI player that uses Monte Carlo Tree Search (MCTS).
@@ -74,15 +251,69 @@ class MctsAI : public Player {
   std::shared_ptr<const Node> prev_tree() const { return prev_tree_; }
   int prev_move() const { return tree_->move; }
 
+  const SearchStats& last_search_stats() const { return last_search_stats_; }
+
  private:
-  void Iteration(Board board);
+  // Runs single iterations and backpropagations for benchmarks and tests,
+  // see ai/mcts_benchmark.cc and ai/mcts_test.cc.
+  friend class MctsAIPeer;
+
+  // The result of a single rollout, waiting to be backpropagated.
+  struct RolloutResult {
+    Node* node = nullptr;
+    double p0_wins = 0.0;
+    // If the leaf search proved the result of `node`, the winner.
+    int proven_winner = -1;
+    // The moves played by each player during the rollout, if using RAVE.
+    std::bitset<128> played[2];
+    // With a network, the moves from `node` and their priors, to expand it.
+    std::vector<Board::Move> moves;
+    std::vector<float> priors;
+    // The virtual loss to take back from the path to `node`.
+    int virtual_loss = 0;
+  };
+
+  // The state of a search thread.
+  struct Worker {
+    explicit Worker(std::seed_seq& seed) : rng(seed) {}
+
+    // Rollout results waiting to be backpropagated, see Iteration.
+    std::vector<RolloutResult> results;
+    // The time spent blocked on tree_mutex_.
+    absl::Duration lock_wait;
+    // The thread's own generator, see MctsOptions::seed.
+    std::mt19937_64 rng;
+  };
+
+  // Runs one iteration of MCTS for `worker`. Rollout results are kept in the
+  // worker's results, and backpropagated by its next iteration, so that the
+  // tree is locked only once per iteration.
+  void Iteration(Board board, Worker* worker);
+
+  // Locks tree_mutex_, adding the time spent blocked on it to `lock_wait`.
+  std::unique_lock<std::mutex> LockTree(absl::Duration* lock_wait);
+
+  // Updates the tree with a rollout result. Requires tree_mutex_.
+  void Backpropagate(const RolloutResult& result);
+
+  // Returns true if the search can stop, with at most
+  // `remaining_iterations` iterations left to add visits to the tree.
+  // Backpropagates the worker's results first.
+  bool ShouldStopEarly(int remaining_iterations, Worker* worker);
 
   int player_id_;
   MctsOptions options_;
 
+  // The seed, and the number of searches run, from which the generators of
+  // the search threads are seeded.
+  uint64_t seed_;
+  uint32_t num_searches_ = 0;
+
   std::mutex tree_mutex_;
   std::shared_ptr<Node> tree_;
   std::shared_ptr<Node> prev_tree_;
+
+  SearchStats last_search_stats_;
 };
 
 }  // namespace santorini
@@ -0,0 +1,139 @@
+// Microbenchmarks of the layers of MctsAI: expanding a node, a single
+// search iteration, and whole searches at a fixed iteration count.
+//
+// To run the benchmark:
+//   $ bazel run -c opt ai:mcts_benchmark
+//
+// The last argument is the game phase of the corpus positions measured on,
+// see game/benchmark_positions.h. Besides the rates, the reported counters
+// are the heap allocations and bytes allocated per benchmark iteration
+// (allocs, bytes_alloc).
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "ai/mcts.h"
+#include "benchmark/benchmark.h"
+#include "game/allocation_counter.h"
+#include "game/benchmark_positions.h"
+#include "game/board.h"
+
+namespace santorini {
+
+// Runs iterations of MctsAI one at a time on the calling thread, from a
+// root that is expanded up front as SelectMove would.
+class MctsAIPeer {
+ public:
+  MctsAIPeer(const Board& board, const MctsOptions& options)
+      : board_(board), ai_(board.current_player(), options) {
+    ExpandNode(board_, /*progressive=*/false, /*rng=*/nullptr,
+               ai_.tree_.get());
+    std::seed_seq seed{1};
+    worker_ = std::make_unique<MctsAI::Worker>(seed);
+  }
+
+  void Iteration() { ai_.Iteration(board_, worker_.get()); }
+
+ private:
+  const Board board_;
+  MctsAI ai_;
+  std::unique_ptr<MctsAI::Worker> worker_;
+};
+
+namespace {
+
+// The game phase, given by the last of the `num_args` arguments.
+GamePhase Phase(const benchmark::State& state, int num_args) {
+  return static_cast<GamePhase>(state.range(num_args - 1));
+}
+
+// Expands a fresh node for each position, with all children (first argument
+// 0) or progressively (1).
+static void BM_ExpandNode(benchmark::State& state) {
+  const std::vector<Board> boards = BenchmarkPositions(Phase(state, 2));
+  const bool progressive = state.range(0) == 1;
+  std::mt19937_64 rng(1);
+  const AllocationCounter allocations;
+  int64_t nodes = 0;
+  for (auto _ : state) {
+    for (const Board& board : boards) {
+      Node node;
+      ExpandNode(board, progressive, &rng, &node);
+      nodes += node.children.size();
+    }
+  }
+  state.counters["nodes/s"] =
+      benchmark::Counter(nodes, benchmark::Counter::kIsRate);
+  allocations.SetCounters(state);
+  state.SetLabel(GamePhaseName(Phase(state, 2)));
+}
+BENCHMARK(BM_ExpandNode)
+    ->ArgsProduct({{0, 1},
+                   benchmark::CreateDenseRange(0, kNumGamePhases - 1,
+                                               /*step=*/1)});
+
+// The number of iterations run on a tree before moving on to the next
+// position, so that the cost is that of a tree of typical depth.
+constexpr int kIterationsPerTree = 1000;
+
+// One MCTS iteration, with default options: selection, expansion, a random
+// rollout and the backpropagation of the previous iteration.
+static void BM_Iteration(benchmark::State& state) {
+  const std::vector<Board> boards = BenchmarkPositions(Phase(state, 1));
+  std::unique_ptr<MctsAIPeer> peer;
+  size_t next = 0;
+  int tree_iterations = kIterationsPerTree;
+  const AllocationCounter allocations;
+  for (auto _ : state) {
+    if (tree_iterations == kIterationsPerTree) {
+      state.PauseTiming();
+      peer = std::make_unique<MctsAIPeer>(boards[next], MctsOptions());
+      next = (next + 1) % boards.size();
+      tree_iterations = 0;
+      state.ResumeTiming();
+    }
+    peer->Iteration();
+    ++tree_iterations;
+  }
+  state.counters["iterations/s"] = benchmark::Counter(
+      state.iterations(), benchmark::Counter::kIsRate);
+  allocations.SetCounters(state);
+  state.SetLabel(GamePhaseName(Phase(state, 1)));
+}
+BENCHMARK(BM_Iteration)->DenseRange(0, kNumGamePhases - 1);
+
+constexpr int kSearchPositionsPerPhase = 4;
+
+// Whole searches of a sample of the positions, with the first argument's
+// number of iterations on one thread. The search runs on a worker thread,
+// so this is timed in real time.
+static void BM_SelectMove(benchmark::State& state) {
+  const std::vector<Board> boards =
+      BenchmarkPositions(Phase(state, 2), kSearchPositionsPerPhase);
+  const MctsOptions options{.num_iterations = static_cast<int>(state.range(0))};
+  const AllocationCounter allocations;
+  int64_t iterations = 0;
+  for (auto _ : state) {
+    for (const Board& board : boards) {
+      MctsAI ai(board.current_player(), options);
+      benchmark::DoNotOptimize(ai.SelectMove(board));
+      iterations += ai.last_search_stats().iterations;
+    }
+  }
+  state.counters["iterations/s"] =
+      benchmark::Counter(iterations, benchmark::Counter::kIsRate);
+  allocations.SetCounters(state);
+  state.SetLabel(GamePhaseName(Phase(state, 2)));
+}
+BENCHMARK(BM_SelectMove)
+    ->ArgsProduct({{1000, 10000},
+                   benchmark::CreateDenseRange(0, kNumGamePhases - 1,
+                                               /*step=*/1)})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace santorini
+
+BENCHMARK_MAIN();
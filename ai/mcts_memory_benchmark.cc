@@ -0,0 +1,99 @@
+// Measures the memory taken by MctsAI search trees.
+//
+// To run the benchmark:
+//   $ bazel run -c opt ai:mcts_memory_benchmark
+//
+// The arguments are the number of iterations of a single-threaded search
+// from a fresh tree, and the game phase of the corpus positions searched,
+// see game/benchmark_positions.h. Each benchmark iteration searches a few
+// positions of the phase, and the tree counters are their means. The
+// reported counters are:
+//   nodes            -- nodes in a searched tree.
+//   bytes_per_node   -- tree bytes divided by nodes.
+//   tree_bytes       -- bytes the tree takes from malloc, see MeasureTree.
+//   node_bytes       -- bytes requested for nodes and their control blocks.
+//   vector_bytes     -- bytes requested for the nodes' vectors.
+//   allocs_per_iter  -- heap allocations made by the search per iteration,
+//                       most of them freed again by rollouts.
+//   peak_rss         -- the high-water mark of the process' resident set.
+//                       Searches run in increasing size, so this is mostly
+//                       the largest tree so far.
+
+#include <sys/resource.h>
+
+#include <vector>
+
+#include "ai/mcts.h"
+#include "benchmark/benchmark.h"
+#include "game/allocation_counter.h"
+#include "game/benchmark_positions.h"
+#include "game/board.h"
+
+namespace santorini {
+namespace {
+
+int64_t PeakRssBytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return int64_t{usage.ru_maxrss} * 1024;
+}
+
+// The number of positions searched per benchmark iteration.
+constexpr int kNumPositions = 4;
+
+static void BM_TreeMemory(benchmark::State& state) {
+  const int num_iterations = state.range(0);
+  const GamePhase phase = static_cast<GamePhase>(state.range(1));
+  const std::vector<Board> boards = BenchmarkPositions(phase, kNumPositions);
+  TreeMemory memory;
+  int64_t allocations = 0;
+  int64_t searches = 0;
+  for (auto _ : state) {
+    memory = TreeMemory();
+    for (const Board& board : boards) {
+      MctsAI ai(board.current_player(),
+                MctsOptions{.num_iterations = num_iterations});
+      const AllocationCounter counter;
+      ai.SelectMove(board);
+      allocations += counter.counts().allocations;
+      ++searches;
+      const TreeMemory tree = MeasureTree(*ai.prev_tree());
+      memory.nodes += tree.nodes;
+      memory.node_bytes += tree.node_bytes;
+      memory.vector_bytes += tree.vector_bytes;
+      memory.allocated_bytes += tree.allocated_bytes;
+    }
+  }
+  // Means over the positions. bytes_per_node is a ratio of sums, weighting
+  // big trees more.
+  state.counters["nodes"] = memory.nodes / boards.size();
+  state.counters["bytes_per_node"] = memory.bytes_per_node();
+  state.counters["tree_bytes"] = benchmark::Counter(
+      memory.allocated_bytes / boards.size(), benchmark::Counter::kDefaults,
+      benchmark::Counter::kIs1024);
+  state.counters["node_bytes"] = benchmark::Counter(
+      memory.node_bytes / boards.size(), benchmark::Counter::kDefaults,
+      benchmark::Counter::kIs1024);
+  state.counters["vector_bytes"] = benchmark::Counter(
+      memory.vector_bytes / boards.size(), benchmark::Counter::kDefaults,
+      benchmark::Counter::kIs1024);
+  state.counters["allocs_per_iter"] =
+      static_cast<double>(allocations) /
+      (searches * num_iterations);
+  state.counters["peak_rss"] = benchmark::Counter(
+      PeakRssBytes(), benchmark::Counter::kDefaults,
+      benchmark::Counter::kIs1024);
+  state.SetLabel(GamePhaseName(phase));
+}
+BENCHMARK(BM_TreeMemory)
+    ->ArgsProduct({{10000, 100000, 1000000},
+                   benchmark::CreateDenseRange(0, kNumGamePhases - 1,
+                                               /*step=*/1)})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kSecond);
+
+}  // namespace
+}  // namespace santorini
+
+BENCHMARK_MAIN();
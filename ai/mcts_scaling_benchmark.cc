@@ -0,0 +1,99 @@
+// Measures how MctsAI::SelectMove scales with search threads.
+//
+// To run the benchmark:
+//   $ bazel run -c opt ai:mcts_scaling_benchmark
+//
+// The arguments are the number of search threads, doubling up to the number
+// of cores, and the parallelization mode:
+//   0  -- tree parallelism: all threads share one tree under tree_mutex_.
+//   1  -- as 0, with a virtual loss on the path each thread selects, so
+//         that threads spread out over different leaves.
+// Each benchmark iteration searches the same sample of corpus positions
+// (see game/benchmark_positions.h) from a fresh tree. The reported counters
+// are:
+//   iterations/s  -- MCTS iterations per second, over all threads.
+//   efficiency    -- iterations/s divided by the threads times that of one
+//                    thread in the same mode.
+//   lock_wait     -- fraction of the threads' time spent blocked on the tree
+//                    lock.
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ai/mcts.h"
+#include "benchmark/benchmark.h"
+#include "game/benchmark_positions.h"
+#include "game/board.h"
+
+namespace santorini {
+namespace {
+
+constexpr int kIterations = 10000;
+constexpr int kPositionsPerPhase = 2;
+constexpr int kNumModes = 2;
+
+std::vector<Board> ScalingPositions() {
+  std::vector<Board> boards;
+  for (int phase = 0; phase < kNumGamePhases; ++phase) {
+    for (const Board& board : BenchmarkPositions(
+             static_cast<GamePhase>(phase), kPositionsPerPhase)) {
+      boards.push_back(board);
+    }
+  }
+  return boards;
+}
+
+MctsOptions ModeOptions(int mode, int num_threads) {
+  return MctsOptions{.num_iterations = kIterations,
+                     .num_threads = num_threads,
+                     .virtual_loss = mode == 1 ? 1 : 0};
+}
+
+static void BM_SelectMoveScaling(benchmark::State& state) {
+  static double single_thread_rate[kNumModes] = {};
+  const int num_threads = state.range(0);
+  const int mode = state.range(1);
+  const std::vector<Board> boards = ScalingPositions();
+
+  int64_t iterations = 0;
+  absl::Duration elapsed;
+  absl::Duration lock_wait;
+  for (auto _ : state) {
+    const absl::Time start = absl::Now();
+    for (const Board& board : boards) {
+      MctsAI ai(board.current_player(), ModeOptions(mode, num_threads));
+      benchmark::DoNotOptimize(ai.SelectMove(board));
+      iterations += ai.last_search_stats().iterations;
+      lock_wait += ai.last_search_stats().lock_wait;
+    }
+    elapsed += absl::Now() - start;
+  }
+
+  // Benchmarks run in order of registration, so one thread comes first.
+  const double rate = iterations / absl::ToDoubleSeconds(elapsed);
+  if (num_threads == 1) single_thread_rate[mode] = rate;
+  state.counters["iterations/s"] = rate;
+  if (single_thread_rate[mode] > 0) {
+    state.counters["efficiency"] =
+        rate / (num_threads * single_thread_rate[mode]);
+  }
+  state.counters["lock_wait"] =
+      absl::FDivDuration(lock_wait, num_threads * elapsed);
+  state.SetLabel(mode == 1 ? "virtual loss" : "tree");
+}
+BENCHMARK(BM_SelectMoveScaling)
+    ->ArgsProduct({benchmark::CreateRange(
+                       1, std::max(1u, std::thread::hardware_concurrency()),
+                       /*multi=*/2),
+                   benchmark::CreateDenseRange(0, kNumModes - 1,
+                                               /*step=*/1)})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace santorini
+
+BENCHMARK_MAIN();
@@ -0,0 +1,526 @@
+#include "ai/mcts.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "ai/network.h"
+#include "ai/tactics.h"
+#include "ai/warm_tree.h"
+#include "game/board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+
+// Backpropagates rollout results into the tree of an MctsAI.
+class MctsAIPeer {
+ public:
+  explicit MctsAIPeer(MctsAI* ai) : ai_(ai) {}
+
+  Node* tree() { return ai_->tree_.get(); }
+
+  // Backpropagates a rollout from `node` in which each player played the
+  // moves in played[player].
+  void Backpropagate(Node* node, double p0_wins,
+                     const std::bitset<128> played[2]) {
+    MctsAI::RolloutResult result;
+    result.node = node;
+    result.p0_wins = p0_wins;
+    result.played[0] = played[0];
+    result.played[1] = played[1];
+    ai_->Backpropagate(result);
+  }
+
+  // Backpropagates a network evaluation of `node`, which expands it with
+  // `moves` and their `priors`.
+  void BackpropagateEvaluation(Node* node, double p0_wins,
+                               const std::vector<Board::Move>& moves,
+                               const std::vector<float>& priors) {
+    MctsAI::RolloutResult result;
+    result.node = node;
+    result.p0_wins = p0_wins;
+    result.moves = moves;
+    result.priors = priors;
+    ai_->Backpropagate(result);
+  }
+
+ private:
+  MctsAI* ai_;
+};
+
+namespace {
+
+// A middle game position with moves that climb by different amounts.
+constexpr char kMidgame[] = "0A2b1a11/04201/001B00/01010/10000 0";
+
+// Player 0 can't win right away, but some of their moves leave player 1
+// without any move.
+constexpr char kTrap[] = "22321/40A433/44130B/43444/11a331b 0";
+
+// Player 0 can climb to level 3.
+constexpr char kWinInOne[] = "11420/342A40/130a30/10B434/41210b 0";
+
+// Player 0 wins on their second move, whatever player 1 does.
+constexpr char kWinInThree[] = "0A1a220/34140/13030/10B433/30110b 0";
+
+Node* FindChild(const Node& node, int move) {
+  for (const std::shared_ptr<Node>& child : node.children) {
+    if (child->move == move) return child.get();
+  }
+  return nullptr;
+}
+
+// The network's policy over the moves of `board`, normalized with a softmax.
+std::vector<float> NetworkPriors(const Network& network, const Board& board,
+                                 const std::vector<Board::Move>& moves) {
+  NetworkOutput output;
+  network.Evaluate(board, &output);
+  std::vector<float> priors;
+  double total = 0;
+  for (const Board::Move& move : moves) {
+    priors.push_back(std::exp(output.policy[move.move_id]));
+    total += priors.back();
+  }
+  for (float& prior : priors) prior /= total;
+  return priors;
+}
+
+// Checks that every expanded node below `node`, the node for `board`, in a
+// PUCT search has a single child for each move, with the network's prior.
+void CheckPuctTree(const Network& network, const Node& node, Board* board) {
+  if (!node.expanded) return;
+  const std::vector<Board::Move> moves = board->PossibleMoves();
+  ASSERT_EQ(node.children.size(), moves.size()) << node.DebugString();
+  const std::vector<float> priors = NetworkPriors(network, *board, moves);
+  for (size_t i = 0; i < moves.size(); ++i) {
+    const Node* child = FindChild(node, moves[i].move_id);
+    ASSERT_NE(child, nullptr) << MoveDebugString(moves[i].move_id);
+    EXPECT_NEAR(child->prior, priors[i], 1e-5) << child->DebugString();
+    ASSERT_TRUE(board->MakeMove(child->move));
+    CheckPuctTree(network, *child, board);
+    board->UnmakeMove();
+  }
+}
+
+// The prior that ExpandNode orders moves by.
+int Prior(const Board& board, const Board::Move& move) {
+  if (move.is_winning) return 100;
+  const Board::MoveSquares squares = board.DecodeMove(move.move_id);
+  return board.height(squares.to_row, squares.to_col) -
+         board.height(squares.from_row, squares.from_col);
+}
+
+int Prior(const Board& board, int move_id) {
+  for (const Board::Move& move : board.PossibleMoves()) {
+    if (move.move_id == move_id) return Prior(board, move);
+  }
+  ADD_FAILURE() << "Illegal move " << MoveDebugString(move_id);
+  return -1;
+}
+
+// Checks the children of every expanded node below the root of a search
+// with progressive widening. A node selected with n visits is widened to
+// ceil(c * n^alpha) children, except on the selection that expanded it,
+// which adds only the first.
+void CheckWidening(const MctsOptions& options, const Node& node,
+                   Board* board) {
+  for (const std::shared_ptr<Node>& child : node.children) {
+    ASSERT_TRUE(board->MakeMove(child->move));
+    if (child->expanded) {
+      const int num_moves = board->PossibleMoves().size();
+      EXPECT_EQ(child->children.size() + child->unexpanded_moves.size(),
+                num_moves);
+      const int widened = std::min<int>(
+          num_moves, std::ceil(options.widening_c *
+                               std::pow(std::max(child->visits - 1, 1),
+                                        options.widening_alpha)));
+      if (child->children.size() != 1) {
+        EXPECT_EQ(child->children.size(), widened) << child->DebugString();
+      }
+      CheckWidening(options, *child, board);
+    }
+    board->UnmakeMove();
+  }
+}
+
+TEST(MctsTest, ExpandNodeAddsEveryMove) {
+  const Board board(kMidgame);
+  Node node;
+  ExpandNode(board, /*progressive=*/false, /*rng=*/nullptr, &node);
+  EXPECT_TRUE(node.expanded);
+  EXPECT_EQ(node.children.size(), board.PossibleMoves().size());
+  EXPECT_TRUE(node.unexpanded_moves.empty());
+  for (const std::shared_ptr<Node>& child : node.children) {
+    EXPECT_EQ(child->player, 0);
+    EXPECT_EQ(child->parent, &node);
+    EXPECT_FALSE(child->expanded);
+    // No move in this position wins right away, and whether a move leaves
+    // the opponent without moves is only checked on selection.
+    EXPECT_FALSE(child->terminal_win);
+    EXPECT_FALSE(child->terminal_checked);
+  }
+}
+
+TEST(MctsTest, ProgressiveExpandNodeOrdersMovesByPrior) {
+  const Board board(kMidgame);
+  std::mt19937_64 rng(1);
+  Node node;
+  ExpandNode(board, /*progressive=*/true, &rng, &node);
+  ASSERT_EQ(node.children.size(), 1);
+  EXPECT_EQ(node.children.size() + node.unexpanded_moves.size(),
+            board.PossibleMoves().size());
+
+  // The next move to add is at the back, so priors increase towards it, and
+  // the first child has the highest prior of all.
+  const int first_prior = Prior(board, node.children[0]->move);
+  for (size_t i = 0; i < node.unexpanded_moves.size(); ++i) {
+    const int prior = Prior(board, node.unexpanded_moves[i]);
+    EXPECT_LE(prior, first_prior);
+    if (i > 0) {
+      EXPECT_GE(prior, Prior(board, node.unexpanded_moves[i - 1]));
+    }
+  }
+}
+
+TEST(MctsTest, ProgressiveExpandNodeAddsWinningMoveFirst) {
+  const Board board(kWinInOne);
+  std::mt19937_64 rng(1);
+  Node node;
+  ExpandNode(board, /*progressive=*/true, &rng, &node);
+  ASSERT_EQ(node.children.size(), 1);
+  EXPECT_TRUE(node.children[0]->terminal_win);
+  EXPECT_TRUE(node.children[0]->terminal_checked);
+}
+
+TEST(MctsTest, ProgressiveWideningChildCount) {
+  MctsOptions options;
+  options.num_iterations = 3000;
+  options.progressive_widening = true;
+  options.seed = 1;
+  Board board(kMidgame);
+  MctsAI ai(0, options);
+  ai.SelectMove(board);
+  const Node& root = *ai.prev_tree();
+  // The root always has every move.
+  EXPECT_EQ(root.children.size(), board.PossibleMoves().size());
+  CheckWidening(options, root, &board);
+}
+
+TEST(MctsTest, DeferredTerminalCheck) {
+  MctsOptions options;
+  options.num_iterations = 500;
+  options.seed = 1;
+  Board board(kTrap);
+  MctsAI ai(0, options);
+  const int move = ai.SelectMove(board);
+
+  // Children are checked for leaving the opponent without moves once they
+  // are selected, and the search then always plays such a move.
+  int num_traps = 0;
+  for (const std::shared_ptr<Node>& child : ai.prev_tree()->children) {
+    ASSERT_TRUE(board.MakeMove(child->move));
+    const bool trap = board.PossibleMoves().empty();
+    board.UnmakeMove();
+    num_traps += trap;
+    EXPECT_EQ(child->terminal_checked, child->visits > 0);
+    if (child->terminal_checked) {
+      EXPECT_EQ(child->terminal_win, trap) << child->DebugString();
+    }
+  }
+  ASSERT_GT(num_traps, 0);
+  ASSERT_TRUE(board.MakeMove(move));
+  EXPECT_TRUE(board.PossibleMoves().empty());
+}
+
+TEST(MctsTest, LeafSearchProvesForcedWin) {
+  MctsOptions options;
+  options.num_iterations = 300;
+  options.leaf_minimax_depth = 2;
+  options.seed = 1;
+  Board board(kWinInThree);
+  MctsAI ai(0, options);
+  const int move = ai.SelectMove(board);
+
+  // The played move leaves player 1 lost within two plies, which the leaf
+  // search proved.
+  const Node* played = FindChild(*ai.prev_tree(), move);
+  ASSERT_NE(played, nullptr);
+  EXPECT_EQ(played->proven_winner, 0) << played->DebugString();
+  EXPECT_TRUE(played->terminal_win);
+  EXPECT_TRUE(played->leaf_searched);
+  EXPECT_FALSE(played->expanded);
+  ASSERT_TRUE(board.MakeMove(move));
+  EXPECT_EQ(SolveShallow(&board, 2), TacticalResult::kLoss);
+}
+
+TEST(MctsTest, RolloutSearchFindsForcedWin) {
+  MctsOptions options;
+  options.num_iterations = 1000;
+  options.rollout_minimax_depth = 2;
+  options.seed = 1;
+  // Player 0 wins within three plies, but random rollouts often miss it.
+  Board board("00041a/0b1422/1130A0/04301/0B0010 0");
+  MctsAI ai(0, options);
+  const int move = ai.SelectMove(board);
+
+  // Every rollout from the played move ends in a proven win, rather than
+  // being played out at random.
+  const Node* played = FindChild(*ai.prev_tree(), move);
+  ASSERT_NE(played, nullptr);
+  EXPECT_EQ(played->wins, played->visits) << played->DebugString();
+  ASSERT_TRUE(board.MakeMove(move));
+  EXPECT_EQ(SolveShallow(&board, 2), TacticalResult::kLoss);
+}
+
+TEST(MctsTest, PuctChildrenGetTheNetworkPriors) {
+  const Network network(NetworkShape{.hidden_size = 16});
+  for (int num_threads : {1, 4}) {
+    MctsOptions options;
+    options.num_iterations = 500;
+    options.network = &network;
+    options.num_threads = num_threads;
+    options.virtual_loss = num_threads > 1 ? 1 : 0;
+    options.seed = 1;
+    Board board(kMidgame);
+    MctsAI ai(0, options);
+    ai.SelectMove(board);
+    CheckPuctTree(network, *ai.prev_tree(), &board);
+  }
+}
+
+TEST(MctsTest, NetworkLeafIsExpandedOnce) {
+  const Network network(NetworkShape{.hidden_size = 16});
+  MctsOptions options;
+  options.network = &network;
+  MctsAI ai(0, options);
+  MctsAIPeer peer(&ai);
+  Board board(kMidgame);
+  Node* root = peer.tree();
+  ExpandNode(board, /*progressive=*/false, /*rng=*/nullptr, root);
+  Node* leaf = root->children[0].get();
+  ASSERT_TRUE(board.MakeMove(leaf->move));
+  const std::vector<Board::Move> moves = board.PossibleMoves();
+  const std::vector<float> priors = NetworkPriors(network, board, moves);
+
+  // Two threads evaluated the same leaf. Only the first expands it, and
+  // both add a visit.
+  peer.BackpropagateEvaluation(leaf, 0.25, moves, priors);
+  ASSERT_TRUE(leaf->expanded);
+  std::vector<Node*> children;
+  for (const std::shared_ptr<Node>& child : leaf->children) {
+    children.push_back(child.get());
+  }
+  peer.BackpropagateEvaluation(leaf, 0.25, moves, priors);
+  ASSERT_EQ(leaf->children.size(), children.size());
+  for (size_t i = 0; i < children.size(); ++i) {
+    EXPECT_EQ(leaf->children[i].get(), children[i]);
+    EXPECT_EQ(leaf->children[i]->prior, priors[i]);
+  }
+  EXPECT_EQ(leaf->visits, 2);
+  EXPECT_DOUBLE_EQ(leaf->wins, 0.5);
+}
+
+TEST(MctsTest, PuctSearchFindsForcedWin) {
+  const Network network(NetworkShape{.hidden_size = 16});
+  MctsOptions options;
+  options.num_iterations = 2000;
+  options.network = &network;
+  options.seed = 1;
+  const Board board(kWinInThree);
+  MctsAI first(0, options);
+  const int move = first.SelectMove(board);
+  Board after = board;
+  ASSERT_TRUE(after.MakeMove(move));
+  EXPECT_EQ(SolveShallow(&after, 2), TacticalResult::kLoss);
+
+  // With a fixed seed, the search is repeatable.
+  MctsAI second(0, options);
+  EXPECT_EQ(second.SelectMove(board), move);
+  EXPECT_EQ(second.last_search_stats().root_visits,
+            first.last_search_stats().root_visits);
+}
+
+TEST(MctsTest, AmafCountsOnlyMovesOfTheSamePlayer) {
+  MctsOptions options;
+  options.rave_equivalence = 1000;
+  MctsAI ai(0, options);
+  MctsAIPeer peer(&ai);
+  Board board;
+  Node* root = peer.tree();
+  ExpandNode(board, /*progressive=*/false, /*rng=*/nullptr, root);
+  Node* first = root->children[0].get();
+  ASSERT_TRUE(board.MakeMove(first->move));
+  ExpandNode(board, /*progressive=*/false, /*rng=*/nullptr, first);
+
+  // Find another root move that player 1 can also play after the first, so
+  // that one move id stands for a move of each player.
+  Node* other = nullptr;
+  Node* same_id = nullptr;
+  for (const std::shared_ptr<Node>& child : root->children) {
+    if (child.get() == first) continue;
+    same_id = FindChild(*first, child->move);
+    if (same_id != nullptr) {
+      other = child.get();
+      break;
+    }
+  }
+  ASSERT_NE(other, nullptr);
+  Node* leaf = nullptr;
+  for (const std::shared_ptr<Node>& child : first->children) {
+    if (child.get() != same_id) leaf = child.get();
+  }
+  ASSERT_NE(leaf, nullptr);
+
+  // A rollout from `leaf`, won by player 0, in which player 0 played the
+  // other root move.
+  std::bitset<128> played[2];
+  played[0].set(other->move);
+  peer.Backpropagate(leaf, 1.0, played);
+
+  // Player 0's moves at the root: the one in the tree and the one in the
+  // rollout.
+  for (const std::shared_ptr<Node>& child : root->children) {
+    const bool amaf = child.get() == first || child.get() == other;
+    EXPECT_EQ(child->amaf_visits, amaf ? 1 : 0) << child->DebugString();
+    EXPECT_EQ(child->amaf_wins, amaf ? 1.0 : 0.0) << child->DebugString();
+  }
+  // Player 1's moves after the first: only the one in the tree. The move
+  // with the same id as player 0's rollout move doesn't count.
+  for (const std::shared_ptr<Node>& child : first->children) {
+    EXPECT_EQ(child->amaf_visits, child.get() == leaf ? 1 : 0)
+        << child->DebugString();
+    EXPECT_EQ(child->amaf_wins, 0.0) << child->DebugString();
+  }
+  EXPECT_EQ(same_id->amaf_visits, 0);
+}
+
+TEST(MctsTest, EarlyStoppingPlaysTheMoveOfTheFullSearch) {
+  int iterations_saved = 0;
+  for (const char* notation :
+       {"00000/00A00a0/00000/00B00b0/00000 0", kMidgame,
+        "00000/01001/010A00/0B3311/130b2a0 1",
+        "1040a1/32A000/0000B0/01211/0011b1 1"}) {
+    for (int rollouts : {1, 3}) {
+      const Board board(notation);
+      MctsOptions options;
+      options.num_iterations = 3000;
+      options.num_rollouts_per_iteration = rollouts;
+      options.seed = 1;
+      MctsAI full(board.current_player(), options);
+      options.early_stopping = true;
+      MctsAI early(board.current_player(), options);
+      EXPECT_EQ(early.SelectMove(board), full.SelectMove(board))
+          << notation << " with " << rollouts << " rollouts";
+      iterations_saved += early.last_search_stats().iterations_saved;
+    }
+  }
+  EXPECT_GT(iterations_saved, 0);
+}
+
+TEST(MctsTest, ReusesTreeAfterOpponentMove) {
+  MctsOptions options;
+  options.num_iterations = 2000;
+  options.seed = 1;
+  Board board;
+  MctsAI ai(0, options);
+  ASSERT_TRUE(board.MakeMove(ai.SelectMove(board)));
+  const Node* played = FindChild(*ai.prev_tree(), board.past_moves().back());
+  ASSERT_NE(played, nullptr);
+
+  // Reply with the opponent's most visited move, which has a subtree.
+  const Node* reply = nullptr;
+  for (const std::shared_ptr<Node>& child : played->children) {
+    if (reply == nullptr || child->visits > reply->visits) {
+      reply = child.get();
+    }
+  }
+  ASSERT_NE(reply, nullptr);
+  const int reply_visits = reply->visits;
+  ASSERT_GT(reply_visits, 0);
+  ASSERT_TRUE(board.MakeMove(reply->move));
+
+  ASSERT_TRUE(board.MakeMove(ai.SelectMove(board)));
+  EXPECT_EQ(ai.prev_tree()->visits, reply_visits + options.num_iterations);
+}
+
+TEST(MctsTest, StartsOverWhenOpponentMoveHasNoChild) {
+  MctsOptions options;
+  options.num_iterations = 200;
+  options.progressive_widening = true;
+  options.seed = 1;
+  Board board;
+  MctsAI ai(0, options);
+  ASSERT_TRUE(board.MakeMove(ai.SelectMove(board)));
+  const Node* played = FindChild(*ai.prev_tree(), board.past_moves().back());
+  ASSERT_NE(played, nullptr);
+  ASSERT_TRUE(played->expanded);
+
+  // Reply with a move the search never added to the tree.
+  int reply = -1;
+  for (const Board::Move& move : board.PossibleMoves()) {
+    if (FindChild(*played, move.move_id) == nullptr) {
+      reply = move.move_id;
+      break;
+    }
+  }
+  ASSERT_NE(reply, -1);
+  ASSERT_TRUE(board.MakeMove(reply));
+
+  ASSERT_TRUE(board.MakeMove(ai.SelectMove(board)));
+  EXPECT_EQ(ai.prev_tree()->move, reply);
+  EXPECT_EQ(ai.prev_tree()->visits, options.num_iterations);
+}
+
+TEST(MctsTest, WarmTreeKeepsImproving) {
+  WarmTree warm_tree;
+  MctsOptions options;
+  options.num_iterations = 2000;
+  options.seed = 1;
+  options.warm_tree = &warm_tree;
+  const Board board;
+
+  MctsAI first(0, options);
+  first.SelectMove(board);
+  EXPECT_EQ(first.last_search_stats().warm_visits, 0);
+  EXPECT_EQ(first.last_search_stats().iterations, 2000);
+  EXPECT_NE(warm_tree.Checkout(board, 1999), nullptr);
+  EXPECT_EQ(warm_tree.Checkout(board, 2000), nullptr);
+
+  // Later searches take over the cached tree, and still add a quarter of
+  // their iterations to it.
+  for (int search = 1; search <= 2; ++search) {
+    MctsAI ai(0, options);
+    ai.SelectMove(board);
+    EXPECT_EQ(ai.last_search_stats().warm_visits, 2000 + 500 * (search - 1));
+    EXPECT_EQ(ai.last_search_stats().iterations, 500);
+    EXPECT_NE(warm_tree.Checkout(board, 1999 + 500 * search), nullptr);
+  }
+}
+
+TEST(MctsTest, WarmTreeKeepsTheBiggerTree) {
+  WarmTree warm_tree;
+  MctsOptions options;
+  options.num_iterations = 2000;
+  options.seed = 1;
+  const Board board;
+  MctsAI big(0, options);
+  big.SelectMove(board);
+  warm_tree.Commit(board, *big.prev_tree());
+  ASSERT_NE(warm_tree.Checkout(board, 1999), nullptr);
+
+  // A smaller search of the same position, say from another game, doesn't
+  // replace it.
+  options.num_iterations = 1000;
+  MctsAI small(0, options);
+  small.SelectMove(board);
+  const int64_t bytes = warm_tree.bytes();
+  warm_tree.Commit(board, *small.prev_tree());
+  EXPECT_NE(warm_tree.Checkout(board, 1999), nullptr);
+  EXPECT_EQ(warm_tree.bytes(), bytes);
+}
+
+}  // namespace
+}  // namespace santorini
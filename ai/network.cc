@@ -0,0 +1,283 @@
+#include "ai/network.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "game/board.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace santorini {
+namespace {
+
+constexpr int kNumSquares = Board::kNumRows * Board::kNumCols;
+constexpr char kMagic[8] = {'S', 'N', 'T', 'N', 'E', 'T', '0', '1'};
+
+// Bounds on the shape read by Network::Load, far above any practical
+// network, so that the size of a file can be computed without overflow.
+constexpr int kMaxHiddenSize = 1 << 16;
+constexpr int kMaxHiddenLayers = 1 << 10;
+
+int PaddedSize(int size) { return (size + 7) / 8 * 8; }
+
+// Returns the size of the file written by Network::Save for `shape`.
+int64_t FileSize(const NetworkShape& shape) {
+  int64_t floats = 0;
+  int64_t inputs = kNumFeatures;
+  for (int i = 0; i < shape.num_hidden_layers; ++i) {
+    floats += (inputs + 1) * shape.hidden_size;
+    inputs = shape.hidden_size;
+  }
+  floats += (inputs + 1) * (1 + kNumPolicyOutputs);
+  return sizeof(kMagic) + 2 * sizeof(int32_t) + floats * sizeof(float);
+}
+
+Network::Layer MakeLayer(int inputs, int outputs, std::mt19937_64* rng) {
+  Network::Layer layer;
+  layer.inputs = inputs;
+  layer.outputs = outputs;
+  layer.stride = PaddedSize(inputs);
+  layer.weights.assign(outputs * layer.stride, 0.0f);
+  layer.biases.assign(outputs, 0.0f);
+  // He initialization, for ReLU layers.
+  std::normal_distribution<float> normal(0.0f, std::sqrt(2.0f / inputs));
+  for (int out = 0; out < outputs; ++out) {
+    for (int in = 0; in < inputs; ++in) {
+      layer.weight(out, in) = normal(*rng);
+    }
+  }
+  return layer;
+}
+
+// Computes `layer` for `batch_size` inputs, each `layer.stride` floats long,
+// writing outputs `out_stride` floats apart. Each row of weights is loaded
+// once and applied to the whole batch.
+void DenseScalar(const Network::Layer& layer, const float* in, int batch_size,
+                 float* out, int out_stride) {
+  for (int o = 0; o < layer.outputs; ++o) {
+    const float* w = &layer.weights[o * layer.stride];
+    for (int b = 0; b < batch_size; ++b) {
+      const float* x = in + b * layer.stride;
+      float sum = layer.biases[o];
+      for (int i = 0; i < layer.stride; ++i) {
+        sum += w[i] * x[i];
+      }
+      out[b * out_stride + o] = sum;
+    }
+  }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma"))) void DenseAvx2(
+    const Network::Layer& layer, const float* in, int batch_size, float* out,
+    int out_stride) {
+  for (int o = 0; o < layer.outputs; ++o) {
+    const float* w = &layer.weights[o * layer.stride];
+    for (int b = 0; b < batch_size; ++b) {
+      const float* x = in + b * layer.stride;
+      __m256 sum = _mm256_setzero_ps();
+      for (int i = 0; i < layer.stride; i += 8) {
+        sum = _mm256_fmadd_ps(_mm256_loadu_ps(w + i), _mm256_loadu_ps(x + i),
+                              sum);
+      }
+      __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum),
+                               _mm256_extractf128_ps(sum, 1));
+      half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+      half = _mm_add_ss(half, _mm_movehdup_ps(half));
+      out[b * out_stride + o] = layer.biases[o] + _mm_cvtss_f32(half);
+    }
+  }
+}
+
+const bool kHaveAvx2 =
+    __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+
+void Dense(const Network::Layer& layer, const float* in, int batch_size,
+           float* out, int out_stride) {
+#if defined(__x86_64__)
+  if (kHaveAvx2) {
+    DenseAvx2(layer, in, batch_size, out, out_stride);
+    return;
+  }
+#endif
+  DenseScalar(layer, in, batch_size, out, out_stride);
+}
+
+void Relu(float* values, int size) {
+  for (int i = 0; i < size; ++i) {
+    values[i] = std::max(values[i], 0.0f);
+  }
+}
+
+}  // namespace
+
+void EncodeBoard(const Board& board, float* features) {
+  std::fill(features, features + kNumFeatures, 0.0f);
+  for (int row = 0; row < Board::kNumRows; ++row) {
+    for (int col = 0; col < Board::kNumCols; ++col) {
+      const int square = row * Board::kNumCols + col;
+      features[board.height(row, col) * kNumSquares + square] = 1.0f;
+    }
+  }
+  const int me = board.current_player();
+  for (int player : {me, 1 - me}) {
+    const int plane = player == me ? 5 : 6;
+    for (int worker = 0; worker < 2; ++worker) {
+      const int* square = board.worker(player, worker);
+      features[plane * kNumSquares + square[0] * Board::kNumCols + square[1]] =
+          1.0f;
+    }
+  }
+}
+
+Network::Network(const NetworkShape& shape, uint64_t seed) : shape_(shape) {
+  CHECK_GT(shape.hidden_size, 0);
+  CHECK_GT(shape.num_hidden_layers, 0);
+  std::mt19937_64 rng(seed);
+  int inputs = kNumFeatures;
+  for (int i = 0; i < shape.num_hidden_layers; ++i) {
+    layers_.push_back(MakeLayer(inputs, shape.hidden_size, &rng));
+    inputs = shape.hidden_size;
+  }
+  layers_.push_back(MakeLayer(inputs, 1, &rng));
+  layers_.push_back(MakeLayer(inputs, kNumPolicyOutputs, &rng));
+}
+
+std::unique_ptr<Network> Network::Load(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    LOG(ERROR) << "Can't open network " << path << ": " << strerror(errno);
+    return nullptr;
+  }
+  char magic[8];
+  int32_t sizes[2];
+  if (fread(magic, sizeof(magic), 1, file) != 1 ||
+      memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      fread(sizes, sizeof(sizes), 1, file) != 1 || sizes[0] <= 0 ||
+      sizes[0] > kMaxHiddenSize || sizes[1] <= 0 ||
+      sizes[1] > kMaxHiddenLayers) {
+    LOG(ERROR) << path << " is not a network of this version";
+    fclose(file);
+    return nullptr;
+  }
+  const NetworkShape shape{.hidden_size = sizes[0],
+                           .num_hidden_layers = sizes[1]};
+  // Check the size before allocating the weights, which a corrupt shape
+  // could make huge.
+  const long position = ftell(file);
+  if (fseek(file, 0, SEEK_END) != 0 || ftell(file) != FileSize(shape) ||
+      fseek(file, position, SEEK_SET) != 0) {
+    LOG(ERROR) << "Network " << path << " doesn't have the size of its shape";
+    fclose(file);
+    return nullptr;
+  }
+  auto network = std::make_unique<Network>(shape);
+  bool ok = true;
+  for (Layer& layer : network->layers_) {
+    for (int out = 0; out < layer.outputs && ok; ++out) {
+      float* row = &layer.weights[out * layer.stride];
+      ok = fread(row, sizeof(float), layer.inputs, file) ==
+           static_cast<size_t>(layer.inputs);
+    }
+    ok = ok && fread(layer.biases.data(), sizeof(float), layer.outputs,
+                     file) == static_cast<size_t>(layer.outputs);
+  }
+  fclose(file);
+  if (!ok) {
+    LOG(ERROR) << "Network " << path << " is truncated";
+    return nullptr;
+  }
+  return network;
+}
+
+bool Network::Save(const std::string& path) const {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    LOG(ERROR) << "Can't write network " << path << ": " << strerror(errno);
+    return false;
+  }
+  const int32_t sizes[2] = {shape_.hidden_size, shape_.num_hidden_layers};
+  bool ok = fwrite(kMagic, sizeof(kMagic), 1, file) == 1 &&
+            fwrite(sizes, sizeof(sizes), 1, file) == 1;
+  for (const Layer& layer : layers_) {
+    for (int out = 0; out < layer.outputs && ok; ++out) {
+      const float* row = &layer.weights[out * layer.stride];
+      ok = fwrite(row, sizeof(float), layer.inputs, file) ==
+           static_cast<size_t>(layer.inputs);
+    }
+    ok = ok && fwrite(layer.biases.data(), sizeof(float), layer.outputs,
+                      file) == static_cast<size_t>(layer.outputs);
+  }
+  if (fclose(file) != 0 || !ok) {
+    LOG(ERROR) << "Failed writing network " << path;
+    return false;
+  }
+  return true;
+}
+
+void Network::Evaluate(const Board& board, NetworkOutput* output) const {
+  float features[kNumFeatures];
+  EncodeBoard(board, features);
+  EvaluateBatch(features, 1, output);
+}
+
+void Network::EvaluateBatch(const float* features, int batch_size,
+                            NetworkOutput* outputs) const {
+  // Activations are kept in thread-local buffers, padded to the stride of the
+  // layer that reads them, so that evaluation doesn't allocate once warmed
+  // up.
+  thread_local std::vector<float> buffers[2];
+  const int hidden_stride = PaddedSize(shape_.hidden_size);
+  const int max_stride = std::max(PaddedSize(kNumFeatures), hidden_stride);
+  for (std::vector<float>& buffer : buffers) {
+    if (buffer.size() < static_cast<size_t>(batch_size * max_stride)) {
+      buffer.assign(batch_size * max_stride, 0.0f);
+    }
+  }
+
+  float* in = buffers[0].data();
+  const int input_stride = layers_[0].stride;
+  for (int b = 0; b < batch_size; ++b) {
+    std::copy(features + b * kNumFeatures, features + (b + 1) * kNumFeatures,
+              in + b * input_stride);
+    std::fill(in + b * input_stride + kNumFeatures, in + (b + 1) * input_stride,
+              0.0f);
+  }
+
+  float* out = buffers[1].data();
+  for (int i = 0; i < shape_.num_hidden_layers; ++i) {
+    const Layer& layer = layers_[i];
+    // The padding of the outputs must be zero for the next layer.
+    std::fill(out, out + batch_size * hidden_stride, 0.0f);
+    Dense(layer, in, batch_size, out, hidden_stride);
+    Relu(out, batch_size * hidden_stride);
+    std::swap(in, out);
+  }
+
+  // The heads write to a buffer of their own: the values of the batch, then
+  // its policies, which are copied into `outputs`.
+  thread_local std::vector<float> heads;
+  const size_t heads_size = batch_size * (1 + kNumPolicyOutputs);
+  if (heads.size() < heads_size) heads.resize(heads_size);
+  float* values = heads.data();
+  float* policies = values + batch_size;
+  Dense(layers_[shape_.num_hidden_layers], in, batch_size, values, 1);
+  Dense(layers_[shape_.num_hidden_layers + 1], in, batch_size, policies,
+        kNumPolicyOutputs);
+  for (int b = 0; b < batch_size; ++b) {
+    outputs[b].value = std::tanh(values[b]);
+    std::copy(policies + b * kNumPolicyOutputs,
+              policies + (b + 1) * kNumPolicyOutputs, outputs[b].policy);
+  }
+}
+
+}  // namespace santorini
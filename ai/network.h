@@ -0,0 +1,91 @@
+#ifndef SANTORINI_AI_NETWORK_H_
+#define SANTORINI_AI_NETWORK_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "game/board.h"
+
+namespace santorini {
+
+// The size of the network input. The board is encoded from the point of view
+// of the player to move: a one-hot plane per height (0 to 4), then the
+// squares of our workers, then the squares of the opponent's workers.
+constexpr int kNumFeatures = 7 * Board::kNumRows * Board::kNumCols;
+
+// The number of policy outputs, one per move id.
+constexpr int kNumPolicyOutputs = 128;
+
+// Writes the features of `board` to `features`, which must hold
+// kNumFeatures floats.
+void EncodeBoard(const Board& board, float* features);
+
+struct NetworkShape {
+  // The trunk is a stack of fully connected ReLU layers of this size.
+  int hidden_size = 128;
+  int num_hidden_layers = 2;
+};
+
+struct NetworkOutput {
+  // The expected result for the player to move, from -1 (loss) to 1 (win).
+  float value = 0;
+  // Unnormalized log probabilities of each move id being the best move.
+  // Entries for illegal moves are meaningless.
+  float policy[kNumPolicyOutputs];
+};
+
+// A small value and policy network for the CPU: a fully connected trunk
+// followed by a tanh value head and a linear policy head.
+//
+// Inference uses an AVX2/FMA kernel when the CPU has it, and a portable
+// scalar kernel otherwise. Evaluate is const and allocates nothing, so one
+// network can be shared by any number of search threads.
+class Network {
+ public:
+  // A fully connected layer. Rows of `weights` are padded with zeros to a
+  // multiple of 8 floats, so that the SIMD kernel needs no tail loop.
+  struct Layer {
+    int inputs = 0;
+    int outputs = 0;
+    int stride = 0;
+    std::vector<float> weights;  // outputs x stride
+    std::vector<float> biases;   // outputs
+
+    float& weight(int out, int in) { return weights[out * stride + in]; }
+    float weight(int out, int in) const { return weights[out * stride + in]; }
+  };
+
+  // Creates a network with small random weights.
+  explicit Network(const NetworkShape& shape = {}, uint64_t seed = 1);
+
+  // Reads a network written by Save. Returns null, and logs why, on failure.
+  static std::unique_ptr<Network> Load(const std::string& path);
+
+  // Writes the network to `path`. Returns false, and logs why, on failure.
+  bool Save(const std::string& path) const;
+
+  // Evaluates `board`, which must not be over.
+  void Evaluate(const Board& board, NetworkOutput* output) const;
+
+  // Evaluates `batch_size` encoded boards, stored one after the other in
+  // `features`.
+  void EvaluateBatch(const float* features, int batch_size,
+                     NetworkOutput* outputs) const;
+
+  const NetworkShape& shape() const { return shape_; }
+
+  // The trunk layers, followed by the value and the policy head. Exposed for
+  // training.
+  std::vector<Layer>& layers() { return layers_; }
+  const std::vector<Layer>& layers() const { return layers_; }
+
+ private:
+  NetworkShape shape_;
+  std::vector<Layer> layers_;
+};
+
+}  // namespace santorini
+
+#endif
@@ -0,0 +1,98 @@
+#include "ai/network.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "game/board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+namespace {
+
+// Returns a few positions from the start of a game.
+std::vector<Board> SomePositions() {
+  std::vector<Board> boards = {Board()};
+  for (int i = 0; i < 6; ++i) {
+    Board board = boards.back();
+    const std::vector<Board::Move> moves = board.PossibleMoves();
+    board.MakeMove(moves[(i * 37) % moves.size()].move_id);
+    boards.push_back(board);
+  }
+  return boards;
+}
+
+TEST(NetworkTest, EncodeBoard_OneHeightPerSquare) {
+  float features[kNumFeatures];
+  EncodeBoard(Board(), features);
+  float total = 0;
+  for (float feature : features) total += feature;
+  // 25 heights and 4 workers.
+  EXPECT_EQ(total, 29);
+}
+
+TEST(NetworkTest, BatchMatchesSingleEvaluations) {
+  const Network network(NetworkShape{.hidden_size = 20});
+  const std::vector<Board> boards = SomePositions();
+  std::vector<float> features(boards.size() * kNumFeatures);
+  for (size_t i = 0; i < boards.size(); ++i) {
+    EncodeBoard(boards[i], &features[i * kNumFeatures]);
+  }
+  std::vector<NetworkOutput> batch(boards.size());
+  network.EvaluateBatch(features.data(), boards.size(), batch.data());
+
+  for (size_t i = 0; i < boards.size(); ++i) {
+    NetworkOutput single;
+    network.Evaluate(boards[i], &single);
+    EXPECT_FLOAT_EQ(single.value, batch[i].value);
+    EXPECT_GT(single.value, -1);
+    EXPECT_LT(single.value, 1);
+    for (int move = 0; move < kNumPolicyOutputs; ++move) {
+      EXPECT_FLOAT_EQ(single.policy[move], batch[i].policy[move]);
+    }
+  }
+}
+
+TEST(NetworkTest, SaveAndLoad) {
+  const Network network(NetworkShape{.hidden_size = 24, .num_hidden_layers = 3},
+                        /*seed=*/7);
+  const std::string path = testing::TempDir() + "/network";
+  ASSERT_TRUE(network.Save(path));
+  std::unique_ptr<Network> loaded = Network::Load(path);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_EQ(loaded->shape().hidden_size, 24);
+  EXPECT_EQ(loaded->shape().num_hidden_layers, 3);
+
+  for (const Board& board : SomePositions()) {
+    NetworkOutput expected, actual;
+    network.Evaluate(board, &expected);
+    loaded->Evaluate(board, &actual);
+    EXPECT_EQ(expected.value, actual.value);
+    for (int move = 0; move < kNumPolicyOutputs; ++move) {
+      EXPECT_EQ(expected.policy[move], actual.policy[move]);
+    }
+  }
+}
+
+TEST(NetworkTest, LoadRejectsCorruptShape) {
+  const std::string path = testing::TempDir() + "/corrupt_network";
+  // Shapes that don't match the file, up to one that would take terabytes.
+  const std::vector<std::array<int32_t, 2>> corrupt_sizes = {
+      {16, 2}, {8, 3}, {1 << 30, 1 << 30}, {-8, 2}, {8, 0}};
+  for (const std::array<int32_t, 2>& sizes : corrupt_sizes) {
+    ASSERT_TRUE(Network(NetworkShape{.hidden_size = 8}).Save(path));
+    ASSERT_NE(Network::Load(path), nullptr);
+    FILE* file = fopen(path.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(fseek(file, 8, SEEK_SET), 0);
+    ASSERT_EQ(fwrite(sizes.data(), sizeof(int32_t), 2, file), 2u);
+    fclose(file);
+    EXPECT_EQ(Network::Load(path), nullptr) << sizes[0] << " " << sizes[1];
+  }
+}
+
+}  // namespace
+}  // namespace santorini
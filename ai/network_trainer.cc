@@ -0,0 +1,325 @@
+#include "ai/network_trainer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "ai/network.h"
+#include "ai/training_data.h"
+#include "game/board.h"
+#include "game/packed_board.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace santorini {
+namespace {
+
+constexpr int kNumSquares = Board::kNumRows * Board::kNumCols;
+
+// Kernels over `size` floats, a multiple of 8, as are layer strides.
+float DotScalar(const float* a, const float* b, int size) {
+  float sum = 0;
+  for (int i = 0; i < size; ++i) sum += a[i] * b[i];
+  return sum;
+}
+
+// y += alpha * x.
+void AxpyScalar(float alpha, const float* x, float* y, int size) {
+  for (int i = 0; i < size; ++i) y[i] += alpha * x[i];
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma"))) float DotAvx2(const float* a,
+                                                  const float* b, int size) {
+  __m256 sum = _mm256_setzero_ps();
+  for (int i = 0; i < size; i += 8) {
+    sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum);
+  }
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum),
+                           _mm256_extractf128_ps(sum, 1));
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_add_ss(half, _mm_movehdup_ps(half));
+  return _mm_cvtss_f32(half);
+}
+
+__attribute__((target("avx2,fma"))) void AxpyAvx2(float alpha, const float* x,
+                                                  float* y, int size) {
+  const __m256 a = _mm256_set1_ps(alpha);
+  for (int i = 0; i < size; i += 8) {
+    _mm256_storeu_ps(y + i, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i),
+                                            _mm256_loadu_ps(y + i)));
+  }
+}
+
+const bool kHaveAvx2 =
+    __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+
+float Dot(const float* a, const float* b, int size) {
+#if defined(__x86_64__)
+  if (kHaveAvx2) return DotAvx2(a, b, size);
+#endif
+  return DotScalar(a, b, size);
+}
+
+void Axpy(float alpha, const float* x, float* y, int size) {
+#if defined(__x86_64__)
+  if (kHaveAvx2) {
+    AxpyAvx2(alpha, x, y, size);
+    return;
+  }
+#endif
+  AxpyScalar(alpha, x, y, size);
+}
+
+// Computes `layer` for a batch of inputs `layer.stride` floats apart,
+// writing outputs `out_stride` floats apart.
+void Forward(const Network::Layer& layer, const float* in, int batch_size,
+             float* out, int out_stride) {
+  for (int b = 0; b < batch_size; ++b) {
+    const float* x = in + b * layer.stride;
+    for (int o = 0; o < layer.outputs; ++o) {
+      out[b * out_stride + o] =
+          layer.biases[o] + Dot(&layer.weights[o * layer.stride], x,
+                                layer.stride);
+    }
+  }
+}
+
+// Given the loss gradients `delta` of the outputs of `layer`, `delta_stride`
+// floats apart, adds the gradients of its weights and biases to `gradient`,
+// and, if `in_delta` is not null, sets the gradients of its inputs.
+void Backward(const Network::Layer& layer, const float* in, const float* delta,
+              int delta_stride, int batch_size, Network::Layer* gradient,
+              float* in_delta) {
+  if (in_delta != nullptr) {
+    std::fill(in_delta, in_delta + batch_size * layer.stride, 0.0f);
+  }
+  for (int b = 0; b < batch_size; ++b) {
+    const float* x = in + b * layer.stride;
+    for (int o = 0; o < layer.outputs; ++o) {
+      const float d = delta[b * delta_stride + o];
+      if (d == 0) continue;
+      gradient->biases[o] += d;
+      Axpy(d, x, &gradient->weights[o * layer.stride], layer.stride);
+      if (in_delta != nullptr) {
+        Axpy(d, &layer.weights[o * layer.stride], in_delta + b * layer.stride,
+             layer.stride);
+      }
+    }
+  }
+}
+
+bool SameShape(const std::vector<Network::Layer>& a,
+               const std::vector<Network::Layer>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].weights.size() != b[i].weights.size() ||
+        a[i].biases.size() != b[i].biases.size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Activations and their gradients for a batch, reused across steps.
+struct Workspace {
+  // activations[0] is the input; activations[i + 1] the output of trunk
+  // layer i, each padded to the stride of the layer that reads it.
+  std::vector<std::vector<float>> activations;
+  std::vector<float> deltas[2];
+  // The outputs of the heads and their gradients: a value per example, and
+  // kNumPolicyOutputs policy logits per example.
+  std::vector<float> values;
+  std::vector<float> policies;
+  std::vector<float> value_deltas;
+  std::vector<float> policy_deltas;
+};
+
+}  // namespace
+
+bool MakeTrainingExample(const TrainingRecord& record,
+                         TrainingExample* example) {
+  if (record.winner < 0 || record.visits.empty()) return false;
+
+  // As EncodeBoard.
+  std::fill(example->features, example->features + kNumFeatures, 0.0f);
+  const PackedBoard& position = record.position;
+  for (int square = 0; square < kNumSquares; ++square) {
+    example->features[position.height(square) * kNumSquares + square] = 1.0f;
+  }
+  const int me = position.current_player();
+  for (int player : {me, 1 - me}) {
+    const int plane = player == me ? 5 : 6;
+    for (int worker = 0; worker < 2; ++worker) {
+      example->features[plane * kNumSquares + position.worker(player, worker)] =
+          1.0f;
+    }
+  }
+
+  example->value = record.winner == me ? 1.0f : -1.0f;
+  std::fill(example->policy, example->policy + kNumPolicyOutputs, 0.0f);
+  double total = 0;
+  for (const TrainingRecord::MoveVisits& move : record.visits) {
+    total += move.visits;
+  }
+  for (const TrainingRecord::MoveVisits& move : record.visits) {
+    example->policy[move.move_id] =
+        total > 0 ? move.visits / total : 1.0 / record.visits.size();
+  }
+  return true;
+}
+
+NetworkTrainer::NetworkTrainer(Network* network,
+                               const NetworkTrainerOptions& options)
+    : network_(network), options_(options) {
+  CHECK(network_ != nullptr);
+}
+
+std::vector<Network::Layer> NetworkTrainer::ZeroGradient() const {
+  std::vector<Network::Layer> gradient = network_->layers();
+  for (Network::Layer& layer : gradient) {
+    std::fill(layer.weights.begin(), layer.weights.end(), 0.0f);
+    std::fill(layer.biases.begin(), layer.biases.end(), 0.0f);
+  }
+  return gradient;
+}
+
+TrainingLoss NetworkTrainer::ComputeGradient(
+    const TrainingExample* batch, int batch_size,
+    std::vector<Network::Layer>* gradient) const {
+  const std::vector<Network::Layer>& layers = network_->layers();
+  const int num_hidden = network_->shape().num_hidden_layers;
+  CHECK(SameShape(*gradient, layers));
+
+  thread_local Workspace workspace;
+  workspace.activations.resize(num_hidden + 1);
+  for (int i = 0; i <= num_hidden; ++i) {
+    // Padding must be zero, as the kernels read it.
+    workspace.activations[i].assign(batch_size * layers[i].stride, 0.0f);
+  }
+  workspace.values.resize(batch_size);
+  workspace.policies.resize(batch_size * kNumPolicyOutputs);
+  workspace.value_deltas.resize(batch_size);
+  workspace.policy_deltas.resize(batch_size * kNumPolicyOutputs);
+
+  // Forward.
+  for (int b = 0; b < batch_size; ++b) {
+    std::copy(batch[b].features, batch[b].features + kNumFeatures,
+              &workspace.activations[0][b * layers[0].stride]);
+  }
+  for (int i = 0; i < num_hidden; ++i) {
+    float* out = workspace.activations[i + 1].data();
+    Forward(layers[i], workspace.activations[i].data(), batch_size, out,
+            layers[i + 1].stride);
+    for (int b = 0; b < batch_size; ++b) {
+      for (int o = 0; o < layers[i].outputs; ++o) {
+        float& value = out[b * layers[i + 1].stride + o];
+        value = std::max(value, 0.0f);
+      }
+    }
+  }
+  const float* trunk = workspace.activations[num_hidden].data();
+  Forward(layers[num_hidden], trunk, batch_size, workspace.values.data(), 1);
+  Forward(layers[num_hidden + 1], trunk, batch_size,
+          workspace.policies.data(), kNumPolicyOutputs);
+
+  // Losses, and their gradients with respect to the heads' outputs.
+  TrainingLoss loss;
+  const float scale = 1.0f / batch_size;
+  for (int b = 0; b < batch_size; ++b) {
+    const TrainingExample& example = batch[b];
+    const float* logits = &workspace.policies[b * kNumPolicyOutputs];
+    float* policy_delta = &workspace.policy_deltas[b * kNumPolicyOutputs];
+
+    const float value = std::tanh(workspace.values[b]);
+    const float error = value - example.value;
+    loss.value += error * error;
+    workspace.value_deltas[b] = 2 * error * (1 - value * value) * scale;
+
+    // Softmax cross-entropy over all move ids. Illegal moves have no visits,
+    // so they are pushed down, which doesn't matter to the search.
+    const float max_logit =
+        *std::max_element(logits, logits + kNumPolicyOutputs);
+    float total = 0;
+    for (int m = 0; m < kNumPolicyOutputs; ++m) {
+      policy_delta[m] = std::exp(logits[m] - max_logit);
+      total += policy_delta[m];
+    }
+    const float log_total = std::log(total);
+    for (int m = 0; m < kNumPolicyOutputs; ++m) {
+      if (example.policy[m] > 0) {
+        loss.policy -= example.policy[m] * (logits[m] - max_logit - log_total);
+      }
+      policy_delta[m] = (policy_delta[m] / total - example.policy[m]) *
+                        options_.policy_weight * scale;
+    }
+  }
+  loss.value *= scale;
+  loss.policy *= scale;
+
+  // Backward. The heads both feed their input gradients into the trunk.
+  const int trunk_stride = layers[num_hidden].stride;
+  std::vector<float>& trunk_delta = workspace.deltas[0];
+  std::vector<float>& head_delta = workspace.deltas[1];
+  trunk_delta.resize(batch_size * trunk_stride);
+  head_delta.resize(batch_size * trunk_stride);
+  Backward(layers[num_hidden], trunk, workspace.value_deltas.data(), 1,
+           batch_size, &(*gradient)[num_hidden], trunk_delta.data());
+  Backward(layers[num_hidden + 1], trunk, workspace.policy_deltas.data(),
+           kNumPolicyOutputs, batch_size, &(*gradient)[num_hidden + 1],
+           head_delta.data());
+  for (size_t i = 0; i < trunk_delta.size(); ++i) {
+    trunk_delta[i] += head_delta[i];
+  }
+
+  for (int i = num_hidden - 1; i >= 0; --i) {
+    // Through the ReLU: the gradient only flows where the output was
+    // positive.
+    const int out_stride = layers[i + 1].stride;
+    const float* out = workspace.activations[i + 1].data();
+    std::vector<float>& delta = workspace.deltas[(num_hidden - 1 - i) % 2];
+    for (int j = 0; j < batch_size * out_stride; ++j) {
+      if (out[j] <= 0) delta[j] = 0;
+    }
+    std::vector<float>& in_delta = workspace.deltas[(num_hidden - i) % 2];
+    if (i > 0) in_delta.resize(batch_size * layers[i].stride);
+    Backward(layers[i], workspace.activations[i].data(), delta.data(),
+             out_stride, batch_size, &(*gradient)[i],
+             i > 0 ? in_delta.data() : nullptr);
+  }
+  return loss;
+}
+
+TrainingLoss NetworkTrainer::Step(const TrainingExample* batch,
+                                  int batch_size) {
+  // Gradients are left zeroed after each step, so they only need to be
+  // reallocated when this thread trains a network of another shape.
+  thread_local std::vector<Network::Layer> gradient;
+  if (!SameShape(gradient, network_->layers())) {
+    gradient = ZeroGradient();
+  }
+  const TrainingLoss loss = ComputeGradient(batch, batch_size, &gradient);
+
+  const float learning_rate = options_.learning_rate;
+  const float decay = 1 - learning_rate * options_.weight_decay;
+  for (size_t i = 0; i < gradient.size(); ++i) {
+    Network::Layer& layer = network_->layers()[i];
+    Network::Layer& grad = gradient[i];
+    for (size_t j = 0; j < layer.weights.size(); ++j) {
+      layer.weights[j] =
+          layer.weights[j] * decay - learning_rate * grad.weights[j];
+      grad.weights[j] = 0;
+    }
+    for (size_t j = 0; j < layer.biases.size(); ++j) {
+      layer.biases[j] -= learning_rate * grad.biases[j];
+      grad.biases[j] = 0;
+    }
+  }
+  return loss;
+}
+
+}  // namespace santorini
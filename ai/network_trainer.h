@@ -0,0 +1,77 @@
+#ifndef SANTORINI_AI_NETWORK_TRAINER_H_
+#define SANTORINI_AI_NETWORK_TRAINER_H_
+
+#include <vector>
+
+#include "ai/network.h"
+#include "ai/training_data.h"
+
+namespace santorini {
+
+// A self-play position as network inputs and targets.
+struct TrainingExample {
+  // As EncodeBoard.
+  float features[kNumFeatures];
+  // The result of the game for the player to move: 1 for a win, -1 for a
+  // loss.
+  float value = 0;
+  // The search's visit distribution over move ids.
+  float policy[kNumPolicyOutputs];
+};
+
+// Converts `record`. Returns false if it has no result or no visits.
+bool MakeTrainingExample(const TrainingRecord& record,
+                         TrainingExample* example);
+
+struct NetworkTrainerOptions {
+  float learning_rate = 0.01f;
+
+  // L2 regularization of the weights (not the biases).
+  float weight_decay = 1e-4f;
+
+  // The policy loss is scaled by this relative to the value loss.
+  float policy_weight = 1.0f;
+};
+
+// Mean losses over a batch.
+struct TrainingLoss {
+  // The squared error of the value head.
+  double value = 0;
+  // The cross-entropy of the policy head with the visit distribution.
+  double policy = 0;
+};
+
+// Fits a Network to training examples with minibatch SGD.
+//
+// Forward and backward passes run a whole batch at a time, through the same
+// kind of AVX2/FMA kernels as inference, with scalar fallbacks.
+//
+// Step is meant to be called from many threads at once, Hogwild style: each
+// thread computes the gradient of its own batch, and then applies it to the
+// shared weights without any locking. Updates that race may be partly
+// lost, which costs a little accuracy but no throughput; a consistent copy
+// of the network is only available once all threads are done.
+class NetworkTrainer {
+ public:
+  // `network` must outlive the trainer.
+  NetworkTrainer(Network* network, const NetworkTrainerOptions& options = {});
+
+  // Returns zeroed gradients, shaped like the layers of the network.
+  std::vector<Network::Layer> ZeroGradient() const;
+
+  // Computes the mean loss over `batch` and adds its gradient, without
+  // weight decay, to `gradient`. Doesn't modify the network.
+  TrainingLoss ComputeGradient(const TrainingExample* batch, int batch_size,
+                               std::vector<Network::Layer>* gradient) const;
+
+  // Runs one SGD step on `batch`. Returns the loss before the step.
+  TrainingLoss Step(const TrainingExample* batch, int batch_size);
+
+ private:
+  Network* network_;
+  NetworkTrainerOptions options_;
+};
+
+}  // namespace santorini
+
+#endif
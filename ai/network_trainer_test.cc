@@ -0,0 +1,108 @@
+#include "ai/network_trainer.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "ai/network.h"
+#include "ai/training_data.h"
+#include "game/board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+namespace {
+
+// Returns examples for the positions of a game of random moves, with made
+// up visits and result.
+std::vector<TrainingExample> SomeExamples() {
+  srand(3);
+  std::vector<TrainingExample> examples;
+  Board board;
+  while (board.winner() == -1 && examples.size() < 16) {
+    const std::vector<Board::Move> moves = board.PossibleMoves();
+    if (moves.empty()) break;
+    TrainingRecord record;
+    SetPosition(board, &record);
+    record.winner = examples.size() % 3 == 0 ? 0 : 1;
+    for (const Board::Move& move : moves) {
+      record.visits.push_back({move.move_id, rand() % 100});
+    }
+    TrainingExample& example = examples.emplace_back();
+    EXPECT_TRUE(MakeTrainingExample(record, &example));
+    board.MakeMove(moves[rand() % moves.size()].move_id);
+  }
+  return examples;
+}
+
+double TotalLoss(const TrainingLoss& loss) {
+  return loss.value + loss.policy;
+}
+
+TEST(NetworkTrainerTest, FeaturesMatchEncodeBoard) {
+  Board board;
+  for (int i = 0; i < 10; ++i) {
+    const std::vector<Board::Move> moves = board.PossibleMoves();
+    board.MakeMove(moves[(i * 31) % moves.size()].move_id);
+
+    TrainingRecord record;
+    SetPosition(board, &record);
+    record.winner = 0;
+    record.visits.push_back({moves[0].move_id, 1});
+    TrainingExample example;
+    ASSERT_TRUE(MakeTrainingExample(record, &example));
+    float features[kNumFeatures];
+    EncodeBoard(board, features);
+    for (int f = 0; f < kNumFeatures; ++f) {
+      EXPECT_EQ(example.features[f], features[f]) << f;
+    }
+  }
+}
+
+TEST(NetworkTrainerTest, GradientMatchesFiniteDifferences) {
+  Network network(NetworkShape{.hidden_size = 12, .num_hidden_layers = 2});
+  NetworkTrainer trainer(&network);
+  const std::vector<TrainingExample> examples = SomeExamples();
+  std::vector<Network::Layer> gradient = trainer.ZeroGradient();
+  trainer.ComputeGradient(examples.data(), examples.size(), &gradient);
+
+  constexpr float kEpsilon = 1e-3f;
+  for (size_t l = 0; l < gradient.size(); ++l) {
+    Network::Layer& layer = network.layers()[l];
+    for (int sample = 0; sample < 10; ++sample) {
+      const int out = (sample * 7) % layer.outputs;
+      const int in = (sample * 13 + l) % layer.inputs;
+      const float original = layer.weight(out, in);
+      std::vector<Network::Layer> unused = trainer.ZeroGradient();
+      layer.weight(out, in) = original + kEpsilon;
+      const double plus = TotalLoss(
+          trainer.ComputeGradient(examples.data(), examples.size(), &unused));
+      layer.weight(out, in) = original - kEpsilon;
+      const double minus = TotalLoss(
+          trainer.ComputeGradient(examples.data(), examples.size(), &unused));
+      layer.weight(out, in) = original;
+
+      const double numeric = (plus - minus) / (2 * kEpsilon);
+      EXPECT_NEAR(gradient[l].weight(out, in), numeric,
+                  1e-3 + 0.05 * std::abs(numeric))
+          << "layer " << l << " weight " << out << ", " << in;
+    }
+  }
+}
+
+TEST(NetworkTrainerTest, StepsReduceLoss) {
+  Network network(NetworkShape{.hidden_size = 32});
+  NetworkTrainer trainer(&network, {.learning_rate = 0.05f});
+  const std::vector<TrainingExample> examples = SomeExamples();
+  const TrainingLoss initial = trainer.Step(examples.data(), examples.size());
+  TrainingLoss loss;
+  for (int i = 0; i < 200; ++i) {
+    loss = trainer.Step(examples.data(), examples.size());
+  }
+  // The value targets can be fit exactly. The policy targets are nearly
+  // uniform, so their cross-entropy can't go much below its start.
+  EXPECT_LT(loss.value, 0.1 * initial.value);
+  EXPECT_LT(loss.policy, initial.policy);
+}
+
+}  // namespace
+}  // namespace santorini
@@ -0,0 +1,277 @@
+#include "ai/nnue.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "absl/log/log.h"
+#include "ai/evaluation.h"
+#include "game/board.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace santorini {
+namespace {
+
+constexpr int kNumSquares = Board::kNumRows * Board::kNumCols;
+constexpr int kInputSize = 2 * Nnue::kAccumulatorSize;
+constexpr char kMagic[8] = {'S', 'N', 'T', 'N', 'N', 'U', 'E', '1'};
+
+// Hidden layer sums are scaled down by 2^kHiddenShift before clipping.
+constexpr int kHiddenShift = 6;
+
+// Scores are clipped to this, so that they never look like wins.
+constexpr int kMaxScore = kWinScore / 4;
+
+int HeightFeature(int row, int col, int height) {
+  return height * kNumSquares + row * Board::kNumCols + col;
+}
+
+// The feature of a worker of `player` on (row, col), from the point of view
+// of `perspective`.
+int WorkerFeature(int perspective, int player, int row, int col) {
+  return (player == perspective ? 5 : 6) * kNumSquares +
+         row * Board::kNumCols + col;
+}
+
+void AddFeature(const int16_t* weights, int16_t* values) {
+  for (int i = 0; i < Nnue::kAccumulatorSize; ++i) values[i] += weights[i];
+}
+
+// Sets `after` to `before` plus the `add` columns minus the `sub` columns.
+void ApplyDeltasScalar(const int16_t* before, const int16_t* const add[2],
+                       const int16_t* const sub[2], int16_t* after) {
+  for (int i = 0; i < Nnue::kAccumulatorSize; ++i) {
+    after[i] = before[i] + add[0][i] + add[1][i] - sub[0][i] - sub[1][i];
+  }
+}
+
+// Clips both perspectives to [0, 127] as the input of the hidden layer, the
+// perspective of `player` first.
+void ClipInputScalar(const Nnue::Accumulator& accumulator, int player,
+                     uint8_t* input) {
+  for (int i = 0; i < Nnue::kAccumulatorSize; ++i) {
+    input[i] = std::clamp<int>(accumulator.values[player][i], 0, 127);
+    input[Nnue::kAccumulatorSize + i] =
+        std::clamp<int>(accumulator.values[1 - player][i], 0, 127);
+  }
+}
+
+// Computes the hidden layer sums, before biases and clipping.
+void HiddenScalar(const int8_t weights[][kInputSize], const uint8_t* input,
+                  int32_t* sums) {
+  for (int j = 0; j < Nnue::kHiddenSize; ++j) {
+    int32_t sum = 0;
+    for (int i = 0; i < kInputSize; ++i) {
+      sum += weights[j][i] * input[i];
+    }
+    sums[j] = sum;
+  }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2"))) void HiddenAvx2(
+    const int8_t weights[][kInputSize], const uint8_t* input, int32_t* sums) {
+  const __m256i ones = _mm256_set1_epi16(1);
+  for (int j = 0; j < Nnue::kHiddenSize; ++j) {
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < kInputSize; i += 32) {
+      // Inputs are at most 127, so the pairwise int16 sums can't saturate.
+      const __m256i products = _mm256_maddubs_epi16(
+          _mm256_load_si256(reinterpret_cast<const __m256i*>(input + i)),
+          _mm256_load_si256(reinterpret_cast<const __m256i*>(&weights[j][i])));
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                 _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4e));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xb1));
+    sums[j] = _mm_cvtsi128_si32(half);
+  }
+}
+
+__attribute__((target("avx2"))) void ApplyDeltasAvx2(
+    const int16_t* before, const int16_t* const add[2],
+    const int16_t* const sub[2], int16_t* after) {
+  for (int i = 0; i < Nnue::kAccumulatorSize; i += 16) {
+    __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(before + i));
+    for (int k = 0; k < 2; ++k) {
+      v = _mm256_add_epi16(
+          v, _mm256_load_si256(reinterpret_cast<const __m256i*>(add[k] + i)));
+      v = _mm256_sub_epi16(
+          v, _mm256_load_si256(reinterpret_cast<const __m256i*>(sub[k] + i)));
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(after + i), v);
+  }
+}
+
+__attribute__((target("avx2"))) void ClipInputAvx2(
+    const Nnue::Accumulator& accumulator, int player, uint8_t* input) {
+  const __m256i max = _mm256_set1_epi8(127);
+  for (int half = 0; half < 2; ++half) {
+    const int16_t* values = accumulator.values[half == 0 ? player : 1 - player];
+    for (int i = 0; i < Nnue::kAccumulatorSize; i += 32) {
+      // packus clips to [0, 255] and interleaves the 128-bit lanes, which the
+      // permute undoes.
+      __m256i packed = _mm256_packus_epi16(
+          _mm256_load_si256(reinterpret_cast<const __m256i*>(values + i)),
+          _mm256_load_si256(
+              reinterpret_cast<const __m256i*>(values + i + 16)));
+      packed = _mm256_permute4x64_epi64(_mm256_min_epu8(packed, max), 0xd8);
+      _mm256_store_si256(reinterpret_cast<__m256i*>(
+                             input + half * Nnue::kAccumulatorSize + i),
+                         packed);
+    }
+  }
+}
+
+const bool kHaveAvx2 = __builtin_cpu_supports("avx2");
+#endif
+
+}  // namespace
+
+Nnue::Nnue(uint64_t seed) {
+#if defined(__x86_64__)
+  use_avx2_ = kHaveAvx2;
+#endif
+  std::mt19937_64 rng(seed);
+  std::uniform_int_distribution<int> feature(-32, 32);
+  std::uniform_int_distribution<int> weight(-16, 16);
+  for (auto& column : feature_weights_) {
+    for (int16_t& w : column) w = feature(rng);
+  }
+  for (int16_t& b : feature_biases_) b = 32;
+  for (auto& row : hidden_weights_) {
+    for (int8_t& w : row) w = weight(rng);
+  }
+  for (int32_t& b : hidden_biases_) b = 0;
+  for (int8_t& w : output_weights_) w = weight(rng);
+  output_bias_ = 0;
+}
+
+std::unique_ptr<Nnue> Nnue::Load(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    LOG(ERROR) << "Can't open NNUE " << path << ": " << strerror(errno);
+    return nullptr;
+  }
+  auto nnue = std::make_unique<Nnue>();
+  char magic[8];
+  const bool ok =
+      fread(magic, sizeof(magic), 1, file) == 1 &&
+      memcmp(magic, kMagic, sizeof(kMagic)) == 0 &&
+      fread(nnue->feature_weights_, sizeof(feature_weights_), 1, file) == 1 &&
+      fread(nnue->feature_biases_, sizeof(feature_biases_), 1, file) == 1 &&
+      fread(nnue->hidden_weights_, sizeof(hidden_weights_), 1, file) == 1 &&
+      fread(nnue->hidden_biases_, sizeof(hidden_biases_), 1, file) == 1 &&
+      fread(nnue->output_weights_, sizeof(output_weights_), 1, file) == 1 &&
+      fread(&nnue->output_bias_, sizeof(output_bias_), 1, file) == 1;
+  fclose(file);
+  if (!ok) {
+    LOG(ERROR) << path << " is not an NNUE of this version";
+    return nullptr;
+  }
+  return nnue;
+}
+
+bool Nnue::Save(const std::string& path) const {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    LOG(ERROR) << "Can't write NNUE " << path << ": " << strerror(errno);
+    return false;
+  }
+  const bool ok =
+      fwrite(kMagic, sizeof(kMagic), 1, file) == 1 &&
+      fwrite(feature_weights_, sizeof(feature_weights_), 1, file) == 1 &&
+      fwrite(feature_biases_, sizeof(feature_biases_), 1, file) == 1 &&
+      fwrite(hidden_weights_, sizeof(hidden_weights_), 1, file) == 1 &&
+      fwrite(hidden_biases_, sizeof(hidden_biases_), 1, file) == 1 &&
+      fwrite(output_weights_, sizeof(output_weights_), 1, file) == 1 &&
+      fwrite(&output_bias_, sizeof(output_bias_), 1, file) == 1;
+  if (fclose(file) != 0 || !ok) {
+    LOG(ERROR) << "Failed writing NNUE " << path;
+    return false;
+  }
+  return true;
+}
+
+void Nnue::Refresh(const Board& board, Accumulator* accumulator) const {
+  for (int perspective : {0, 1}) {
+    int16_t* values = accumulator->values[perspective];
+    std::copy(feature_biases_, feature_biases_ + kAccumulatorSize, values);
+    for (int row = 0; row < Board::kNumRows; ++row) {
+      for (int col = 0; col < Board::kNumCols; ++col) {
+        AddFeature(
+            feature_weights_[HeightFeature(row, col, board.height(row, col))],
+            values);
+      }
+    }
+    for (int player : {0, 1}) {
+      for (int worker : {0, 1}) {
+        const int* square = board.worker(player, worker);
+        AddFeature(feature_weights_[WorkerFeature(perspective, player,
+                                                  square[0], square[1])],
+                   values);
+      }
+    }
+  }
+}
+
+void Nnue::Update(const Board& board, int move_id, const Accumulator& before,
+                  Accumulator* after) const {
+  const Board::MoveSquares squares = board.DecodeMove(move_id);
+  const int player = board.current_player();
+  const int build_height = board.height(squares.build_row, squares.build_col);
+  for (int perspective : {0, 1}) {
+    const int16_t* const add[2] = {
+        feature_weights_[WorkerFeature(perspective, player, squares.to_row,
+                                       squares.to_col)],
+        feature_weights_[HeightFeature(squares.build_row, squares.build_col,
+                                       build_height + 1)]};
+    const int16_t* const sub[2] = {
+        feature_weights_[WorkerFeature(perspective, player, squares.from_row,
+                                       squares.from_col)],
+        feature_weights_[HeightFeature(squares.build_row, squares.build_col,
+                                       build_height)]};
+#if defined(__x86_64__)
+    if (use_avx2_) {
+      ApplyDeltasAvx2(before.values[perspective], add, sub,
+                      after->values[perspective]);
+      continue;
+    }
+#endif
+    ApplyDeltasScalar(before.values[perspective], add, sub,
+                      after->values[perspective]);
+  }
+}
+
+int Nnue::Evaluate(const Accumulator& accumulator, int player) const {
+  alignas(32) uint8_t input[kInputSize];
+  int32_t sums[kHiddenSize];
+#if defined(__x86_64__)
+  if (use_avx2_) {
+    ClipInputAvx2(accumulator, player, input);
+    HiddenAvx2(hidden_weights_, input, sums);
+  } else {
+    ClipInputScalar(accumulator, player, input);
+    HiddenScalar(hidden_weights_, input, sums);
+  }
+#else
+  ClipInputScalar(accumulator, player, input);
+  HiddenScalar(hidden_weights_, input, sums);
+#endif
+
+  int32_t output = output_bias_;
+  for (int j = 0; j < kHiddenSize; ++j) {
+    const int32_t hidden =
+        std::clamp((sums[j] + hidden_biases_[j]) >> kHiddenShift, 0, 127);
+    output += output_weights_[j] * hidden;
+  }
+  return std::clamp(output, -kMaxScore, kMaxScore);
+}
+
+}  // namespace santorini
@@ -0,0 +1,81 @@
+#ifndef SANTORINI_AI_NNUE_H_
+#define SANTORINI_AI_NNUE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "game/board.h"
+
+namespace santorini {
+
+// An efficiently updatable network (NNUE) for scoring positions in search.
+//
+// The first layer sees 175 binary features per perspective: a height plane
+// per level (0 to 4) and a plane each for the workers of the perspective's
+// player and of its opponent. Its output, the accumulator, is a sum of one
+// weight column per active feature. A move changes only a handful of
+// features (a worker leaves one square for another, and one square gains a
+// level), so search updates the accumulator with a few vector additions
+// instead of recomputing it.
+//
+// The rest of the network is small and quantized: the two perspectives'
+// accumulators, clipped to [0, 127], feed a 256 -> 32 int8 layer, whose
+// clipped outputs feed a 32 -> 1 int8 layer. Accumulator updates and the
+// int8 layer use AVX2 kernels when the CPU has them, and scalar ones
+// otherwise.
+class Nnue {
+ public:
+  static constexpr int kNumFeatures = 7 * Board::kNumRows * Board::kNumCols;
+  static constexpr int kAccumulatorSize = 128;
+  static constexpr int kHiddenSize = 32;
+
+  // The first layer outputs for the position, from the point of view of
+  // each player.
+  struct Accumulator {
+    alignas(32) int16_t values[2][kAccumulatorSize];
+  };
+
+  // Creates a network with small random weights.
+  explicit Nnue(uint64_t seed = 1);
+
+  // Reads a network written by Save. Returns null, and logs why, on failure.
+  static std::unique_ptr<Nnue> Load(const std::string& path);
+
+  // Writes the network to `path`. Returns false, and logs why, on failure.
+  bool Save(const std::string& path) const;
+
+  // Computes the accumulator of `board` from scratch.
+  void Refresh(const Board& board, Accumulator* accumulator) const;
+
+  // Sets `after` to the accumulator of `board` after `move_id`, given the
+  // accumulator `before` of `board` itself. `board` is not modified; call
+  // this before making the move.
+  void Update(const Board& board, int move_id, const Accumulator& before,
+              Accumulator* after) const;
+
+  // Returns the score of the position for `player`, in the units of
+  // Evaluate() in ai/evaluation.h, and well below kWinScore.
+  int Evaluate(const Accumulator& accumulator, int player) const;
+
+ private:
+  // Compares the scalar kernels with the AVX2 ones, see ai/nnue_test.cc.
+  friend class NnuePeer;
+
+  // Whether to use the AVX2 kernels, which is when the CPU has them.
+  bool use_avx2_ = false;
+
+  // Feature weights, one column of kAccumulatorSize per feature.
+  alignas(32) int16_t feature_weights_[kNumFeatures][kAccumulatorSize];
+  alignas(32) int16_t feature_biases_[kAccumulatorSize];
+  // Hidden layer weights, by output, over both perspectives: the player to
+  // score first.
+  alignas(32) int8_t hidden_weights_[kHiddenSize][2 * kAccumulatorSize];
+  int32_t hidden_biases_[kHiddenSize];
+  int8_t output_weights_[kHiddenSize];
+  int32_t output_bias_;
+};
+
+}  // namespace santorini
+
+#endif
@@ -0,0 +1,141 @@
+// Compares the cost of scoring positions with the NNUE against the static
+// evaluation, and measures alpha-beta search speed with each, on the
+// corpus positions of the game phase given by the last argument, see
+// game/benchmark_positions.h.
+//
+// To run the benchmark:
+//   $ bazel run -c opt ai:nnue_benchmark
+
+#include <memory>
+#include <vector>
+
+#include "ai/alpha_beta.h"
+#include "ai/evaluation.h"
+#include "ai/nnue.h"
+#include "benchmark/benchmark.h"
+#include "game/benchmark_positions.h"
+#include "game/board.h"
+
+namespace santorini {
+namespace {
+
+// The corpus positions of a phase, with the moves from each.
+struct PhasePositions {
+  std::vector<Board> boards;
+  std::vector<std::vector<Board::Move>> moves;
+  int64_t num_moves = 0;
+};
+
+PhasePositions GetPositions(GamePhase phase) {
+  PhasePositions positions;
+  positions.boards = BenchmarkPositions(phase);
+  for (const Board& board : positions.boards) {
+    positions.moves.push_back(board.PossibleMoves());
+    positions.num_moves += positions.moves.back().size();
+  }
+  return positions;
+}
+
+// Makes, scores and unmakes every move from each position.
+static void BM_StaticEvaluate(benchmark::State& state) {
+  const GamePhase phase = static_cast<GamePhase>(state.range(0));
+  PhasePositions positions = GetPositions(phase);
+  for (auto _ : state) {
+    for (size_t i = 0; i < positions.boards.size(); ++i) {
+      Board& board = positions.boards[i];
+      for (const Board::Move& move : positions.moves[i]) {
+        board.MakeMove(move.move_id);
+        benchmark::DoNotOptimize(Evaluate(board, board.current_player()));
+        board.UnmakeMove();
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * positions.num_moves);
+  state.SetLabel(GamePhaseName(phase));
+}
+BENCHMARK(BM_StaticEvaluate)->DenseRange(0, kNumGamePhases - 1);
+
+// As above, updating the NNUE accumulator for each move.
+static void BM_NnueIncremental(benchmark::State& state) {
+  const auto nnue = std::make_unique<Nnue>();
+  const GamePhase phase = static_cast<GamePhase>(state.range(0));
+  PhasePositions positions = GetPositions(phase);
+  std::vector<Nnue::Accumulator> roots(positions.boards.size());
+  for (size_t i = 0; i < positions.boards.size(); ++i) {
+    nnue->Refresh(positions.boards[i], &roots[i]);
+  }
+  Nnue::Accumulator child;
+  for (auto _ : state) {
+    for (size_t i = 0; i < positions.boards.size(); ++i) {
+      Board& board = positions.boards[i];
+      for (const Board::Move& move : positions.moves[i]) {
+        nnue->Update(board, move.move_id, roots[i], &child);
+        board.MakeMove(move.move_id);
+        benchmark::DoNotOptimize(
+            nnue->Evaluate(child, board.current_player()));
+        board.UnmakeMove();
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * positions.num_moves);
+  state.SetLabel(GamePhaseName(phase));
+}
+BENCHMARK(BM_NnueIncremental)->DenseRange(0, kNumGamePhases - 1);
+
+// As above, computing the NNUE accumulator from scratch for each move.
+static void BM_NnueRefresh(benchmark::State& state) {
+  const auto nnue = std::make_unique<Nnue>();
+  const GamePhase phase = static_cast<GamePhase>(state.range(0));
+  PhasePositions positions = GetPositions(phase);
+  Nnue::Accumulator child;
+  for (auto _ : state) {
+    for (size_t i = 0; i < positions.boards.size(); ++i) {
+      Board& board = positions.boards[i];
+      for (const Board::Move& move : positions.moves[i]) {
+        board.MakeMove(move.move_id);
+        nnue->Refresh(board, &child);
+        benchmark::DoNotOptimize(
+            nnue->Evaluate(child, board.current_player()));
+        board.UnmakeMove();
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * positions.num_moves);
+  state.SetLabel(GamePhaseName(phase));
+}
+BENCHMARK(BM_NnueRefresh)->DenseRange(0, kNumGamePhases - 1);
+
+constexpr int kSearchPositionsPerPhase = 4;
+
+// Searches a sample of the positions to depth 5, with the static evaluation
+// (first argument 0) or the NNUE (1).
+static void BM_AlphaBeta(benchmark::State& state) {
+  const auto nnue = std::make_unique<Nnue>();
+  const GamePhase phase = static_cast<GamePhase>(state.range(1));
+  const std::vector<Board> boards =
+      BenchmarkPositions(phase, kSearchPositionsPerPhase);
+  int64_t nodes = 0;
+  for (auto _ : state) {
+    for (const Board& board : boards) {
+      AlphaBetaAI ai(board.current_player(),
+                     AlphaBetaOptions{
+                         .max_depth = 5,
+                         .nnue = state.range(0) == 1 ? nnue.get() : nullptr});
+      benchmark::DoNotOptimize(ai.SelectMove(board));
+      nodes += ai.last_search_stats().nodes;
+    }
+  }
+  state.counters["nodes/s"] =
+      benchmark::Counter(nodes, benchmark::Counter::kIsRate);
+  state.SetLabel(GamePhaseName(phase));
+}
+BENCHMARK(BM_AlphaBeta)
+    ->ArgsProduct({{0, 1},
+                   benchmark::CreateDenseRange(0, kNumGamePhases - 1,
+                                               /*step=*/1)})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace santorini
+
+BENCHMARK_MAIN();
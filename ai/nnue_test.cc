@@ -0,0 +1,105 @@
+#include "ai/nnue.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "game/board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+
+// Switches a network to its scalar kernels.
+class NnuePeer {
+ public:
+  static bool UsesAvx2(const Nnue& nnue) { return nnue.use_avx2_; }
+  static void UseScalar(Nnue* nnue) { nnue->use_avx2_ = false; }
+};
+
+namespace {
+
+bool SameAccumulator(const Nnue::Accumulator& a, const Nnue::Accumulator& b) {
+  return memcmp(a.values, b.values, sizeof(a.values)) == 0;
+}
+
+TEST(NnueTest, UpdateMatchesRefresh) {
+  const auto nnue = std::make_unique<Nnue>();
+  srand(11);
+  for (int game = 0; game < 10; ++game) {
+    Board board;
+    Nnue::Accumulator accumulator;
+    nnue->Refresh(board, &accumulator);
+    while (board.winner() == -1) {
+      const std::vector<Board::Move> moves = board.PossibleMoves();
+      if (moves.empty()) break;
+      const int move = moves[rand() % moves.size()].move_id;
+      Nnue::Accumulator next;
+      nnue->Update(board, move, accumulator, &next);
+      ASSERT_TRUE(board.MakeMove(move));
+      accumulator = next;
+
+      Nnue::Accumulator expected;
+      nnue->Refresh(board, &expected);
+      ASSERT_TRUE(SameAccumulator(accumulator, expected));
+      EXPECT_EQ(nnue->Evaluate(accumulator, 0),
+                nnue->Evaluate(expected, 0));
+    }
+  }
+}
+
+TEST(NnueTest, SaveAndLoad) {
+  const auto nnue = std::make_unique<Nnue>(/*seed=*/3);
+  const std::string path = testing::TempDir() + "/nnue";
+  ASSERT_TRUE(nnue->Save(path));
+  std::unique_ptr<Nnue> loaded = Nnue::Load(path);
+  ASSERT_NE(loaded, nullptr);
+
+  Board board;
+  board.MakeMove(board.PossibleMoves().front().move_id);
+  Nnue::Accumulator expected, actual;
+  nnue->Refresh(board, &expected);
+  loaded->Refresh(board, &actual);
+  EXPECT_TRUE(SameAccumulator(expected, actual));
+  for (int player : {0, 1}) {
+    EXPECT_EQ(nnue->Evaluate(expected, player),
+              loaded->Evaluate(actual, player));
+  }
+}
+
+TEST(NnueTest, ScalarKernelsMatchAvx2) {
+  const auto avx2 = std::make_unique<Nnue>(/*seed=*/5);
+  if (!NnuePeer::UsesAvx2(*avx2)) GTEST_SKIP() << "The CPU has no AVX2";
+  const auto scalar = std::make_unique<Nnue>(/*seed=*/5);
+  NnuePeer::UseScalar(scalar.get());
+
+  srand(13);
+  for (int game = 0; game < 10; ++game) {
+    Board board;
+    Nnue::Accumulator avx2_accumulator, scalar_accumulator;
+    avx2->Refresh(board, &avx2_accumulator);
+    scalar->Refresh(board, &scalar_accumulator);
+    while (board.winner() == -1) {
+      for (int player : {0, 1}) {
+        ASSERT_EQ(scalar->Evaluate(scalar_accumulator, player),
+                  avx2->Evaluate(avx2_accumulator, player))
+            << board.ToNotation();
+      }
+      const std::vector<Board::Move> moves = board.PossibleMoves();
+      if (moves.empty()) break;
+      const int move = moves[rand() % moves.size()].move_id;
+      Nnue::Accumulator avx2_next, scalar_next;
+      avx2->Update(board, move, avx2_accumulator, &avx2_next);
+      scalar->Update(board, move, scalar_accumulator, &scalar_next);
+      ASSERT_TRUE(SameAccumulator(scalar_next, avx2_next))
+          << board.ToNotation();
+      ASSERT_TRUE(board.MakeMove(move));
+      avx2_accumulator = avx2_next;
+      scalar_accumulator = scalar_next;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace santorini
@@ -0,0 +1,210 @@
+#include "ai/opening_book.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "game/board.h"
+#include "game/packed_board.h"
+
+namespace santorini {
+namespace {
+
+constexpr int kNumSquares = Board::kNumRows * Board::kNumCols;
+constexpr int kNumSymmetries = 8;
+
+// Bump the version whenever the positions or the entry layout change, so
+// that old books are rejected rather than misread.
+constexpr char kMagic[8] = {'S', 'N', 'T', 'B', 'O', 'O', 'K', '2'};
+
+struct BookHeader {
+  char magic[8];
+  uint64_t num_entries;
+};
+static_assert(sizeof(BookHeader) == 16);
+
+// Maps a square to its image under one of the 8 symmetries of the board.
+// Bit 0 mirrors the columns, bit 1 mirrors the rows and bit 2 transposes,
+// applied in that order.
+int Transform(int symmetry, int row, int col) {
+  if (symmetry & 1) col = Board::kNumCols - 1 - col;
+  if (symmetry & 2) row = Board::kNumRows - 1 - row;
+  if (symmetry & 4) std::swap(row, col);
+  return row * Board::kNumCols + col;
+}
+
+// The inverse of Transform.
+int InverseTransform(int symmetry, int square) {
+  int row = square / Board::kNumCols;
+  int col = square % Board::kNumCols;
+  if (symmetry & 4) std::swap(row, col);
+  if (symmetry & 2) row = Board::kNumRows - 1 - row;
+  if (symmetry & 1) col = Board::kNumCols - 1 - col;
+  return row * Board::kNumCols + col;
+}
+
+// Returns `board` mapped by `symmetry`, with each player's workers in order
+// of square.
+PackedBoard SymmetricPosition(const Board& board, int symmetry) {
+  int heights[kNumSquares];
+  for (int row = 0; row < Board::kNumRows; ++row) {
+    for (int col = 0; col < Board::kNumCols; ++col) {
+      heights[Transform(symmetry, row, col)] = board.height(row, col);
+    }
+  }
+  int workers[2][2];
+  for (int player = 0; player < 2; ++player) {
+    for (int worker = 0; worker < 2; ++worker) {
+      const int* square = board.worker(player, worker);
+      workers[player][worker] = Transform(symmetry, square[0], square[1]);
+    }
+    if (workers[player][0] > workers[player][1]) {
+      std::swap(workers[player][0], workers[player][1]);
+    }
+  }
+  return PackedBoard(heights, workers, board.current_player());
+}
+
+}  // namespace
+
+PackedBoard CanonicalPosition(const Board& board, int* symmetry) {
+  PackedBoard best = SymmetricPosition(board, 0);
+  int best_symmetry = 0;
+  for (int s = 1; s < kNumSymmetries; ++s) {
+    const PackedBoard position = SymmetricPosition(board, s);
+    if (position < best) {
+      best = position;
+      best_symmetry = s;
+    }
+  }
+  if (symmetry != nullptr) *symmetry = best_symmetry;
+  return best;
+}
+
+uint16_t EncodeBookMove(const Board& board, int move_id, int symmetry) {
+  const Board::MoveSquares squares = board.DecodeMove(move_id);
+  return Transform(symmetry, squares.from_row, squares.from_col) << 10 |
+         Transform(symmetry, squares.to_row, squares.to_col) << 5 |
+         Transform(symmetry, squares.build_row, squares.build_col);
+}
+
+std::unique_ptr<OpeningBook> OpeningBook::Open(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Can't open opening book " << path << ": "
+               << strerror(errno);
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(BookHeader)) {
+    LOG(ERROR) << "Opening book " << path << " is truncated";
+    close(fd);
+    return nullptr;
+  }
+  const size_t length = st.st_size;
+  void* data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "Can't map opening book " << path << ": "
+               << strerror(errno);
+    return nullptr;
+  }
+
+  // Compare entry counts rather than byte sizes, which a corrupt count
+  // could overflow.
+  const auto* header = static_cast<const BookHeader*>(data);
+  const size_t entry_bytes = length - sizeof(BookHeader);
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      entry_bytes % sizeof(BookEntry) != 0 ||
+      entry_bytes / sizeof(BookEntry) != header->num_entries) {
+    LOG(ERROR) << path << " is not an opening book of this version";
+    munmap(data, length);
+    return nullptr;
+  }
+  LOG(INFO) << "Loaded opening book " << path << " with "
+            << header->num_entries << " positions";
+  return std::unique_ptr<OpeningBook>(new OpeningBook(data, length));
+}
+
+OpeningBook::OpeningBook(void* data, size_t length)
+    : data_(data),
+      length_(length),
+      entries_(reinterpret_cast<const BookEntry*>(
+          static_cast<const char*>(data) + sizeof(BookHeader))),
+      num_entries_(static_cast<const BookHeader*>(data)->num_entries) {}
+
+OpeningBook::~OpeningBook() { munmap(data_, length_); }
+
+bool OpeningBook::Probe(const Board& board, BookMove* result) const {
+  int symmetry;
+  const PackedBoard position = CanonicalPosition(board, &symmetry);
+  const BookEntry* end = entries_ + num_entries_;
+  const BookEntry* entry = std::lower_bound(
+      entries_, end, position,
+      [](const BookEntry& e, const PackedBoard& p) { return e.position < p; });
+  if (entry == end || entry->position != position) return false;
+
+  // Map the squares of the book move back to this orientation, and find the
+  // move that touches them. Only a corrupt book can leave no such move.
+  const int from = InverseTransform(symmetry, entry->move >> 10);
+  const int to = InverseTransform(symmetry, (entry->move >> 5) & 31);
+  const int build = InverseTransform(symmetry, entry->move & 31);
+  for (const Board::Move& move : board.PossibleMoves()) {
+    const Board::MoveSquares squares = board.DecodeMove(move.move_id);
+    if (squares.from_row * Board::kNumCols + squares.from_col == from &&
+        squares.to_row * Board::kNumCols + squares.to_col == to &&
+        squares.build_row * Board::kNumCols + squares.build_col == build) {
+      result->move_id = move.move_id;
+      result->visits = entry->visits;
+      result->win_rate = entry->win_rate;
+      return true;
+    }
+  }
+  LOG(WARNING) << "Opening book move at ply " << entry->ply
+               << " is not legal";
+  return false;
+}
+
+bool WriteOpeningBook(const std::string& path,
+                      std::vector<BookEntry> entries) {
+  std::sort(entries.begin(), entries.end(),
+            [](const BookEntry& a, const BookEntry& b) {
+              return a.position < b.position;
+            });
+  entries.erase(std::unique(entries.begin(), entries.end(),
+                            [](const BookEntry& a, const BookEntry& b) {
+                              return a.position == b.position;
+                            }),
+                entries.end());
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    LOG(ERROR) << "Can't write opening book " << path << ": "
+               << strerror(errno);
+    return false;
+  }
+  BookHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.num_entries = entries.size();
+  const bool ok =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      fwrite(entries.data(), sizeof(BookEntry), entries.size(), file) ==
+          entries.size();
+  if (fclose(file) != 0 || !ok) {
+    LOG(ERROR) << "Failed writing opening book " << path;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace santorini
@@ -0,0 +1,87 @@
+#ifndef SANTORINI_AI_OPENING_BOOK_H_
+#define SANTORINI_AI_OPENING_BOOK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "game/board.h"
+#include "game/packed_board.h"
+
+namespace santorini {
+
+// A book entry, as stored in the file. Positions are stored in canonical
+// orientation (see CanonicalPosition below), and so is the move, so that
+// the entry applies to every symmetric copy of the position.
+struct BookEntry {
+  PackedBoard position;
+  // The squares of the move, as row * 5 + col: from << 10 | to << 5 | build.
+  uint16_t move = 0;
+  // The number of moves played before the position.
+  uint16_t ply = 0;
+  // The number of MCTS visits of the move, and its win rate for the player
+  // making it.
+  uint32_t visits = 0;
+  float win_rate = 0;
+  uint32_t reserved = 0;
+};
+static_assert(sizeof(BookEntry) == 32);
+
+// A move found in the book, for the position it was probed with.
+struct BookMove {
+  int move_id = -1;
+  int visits = 0;
+  double win_rate = 0;
+};
+
+// Returns `board` in canonical orientation: the least of its 8 rotations and
+// reflections, each with every player's workers in order of square, so that
+// it is the same for all of them and for either order of workers. If
+// `symmetry` is not null, it is set to the symmetry that maps `board` to its
+// canonical orientation.
+PackedBoard CanonicalPosition(const Board& board, int* symmetry = nullptr);
+
+// Returns the book encoding of `move_id`, a move on `board`, in the
+// orientation given by `symmetry`.
+uint16_t EncodeBookMove(const Board& board, int move_id, int symmetry);
+
+// An opening book, read-only and memory-mapped from a file written by
+// WriteOpeningBook. The file is a small header followed by BookEntry records
+// sorted by position, in native byte order, so probing is a binary search over
+// the mapped pages and loading costs nothing up front. A book can be shared
+// by any number of players and threads.
+class OpeningBook {
+ public:
+  // Maps the book at `path`. Returns null, and logs why, if the file can't be
+  // read or isn't a book.
+  static std::unique_ptr<OpeningBook> Open(const std::string& path);
+
+  ~OpeningBook();
+
+  OpeningBook(const OpeningBook&) = delete;
+  OpeningBook& operator=(const OpeningBook&) = delete;
+
+  // Looks up `board`. Returns false if the position isn't in the book.
+  bool Probe(const Board& board, BookMove* result) const;
+
+  size_t size() const { return num_entries_; }
+
+ private:
+  OpeningBook(void* data, size_t length);
+
+  void* data_;
+  size_t length_;
+  const BookEntry* entries_;
+  size_t num_entries_;
+};
+
+// Sorts `entries` by position and writes them to a book file at `path`. Returns
+// false, and logs why, on failure.
+bool WriteOpeningBook(const std::string& path,
+                      std::vector<BookEntry> entries);
+
+}  // namespace santorini
+
+#endif
@@ -0,0 +1,132 @@
+#include "ai/opening_book.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "game/board.h"
+#include "game/packed_board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+namespace {
+
+// Returns the move on `mirror` that is the mirror image across the middle
+// column of `move_id` on `board`, or -1 if it isn't legal.
+int MirrorMove(const Board& board, const Board& mirror, int move_id) {
+  const Board::MoveSquares squares = board.DecodeMove(move_id);
+  for (const Board::Move& move : mirror.PossibleMoves()) {
+    const Board::MoveSquares mirrored = mirror.DecodeMove(move.move_id);
+    if (mirrored.from_row == squares.from_row &&
+        mirrored.from_col == 4 - squares.from_col &&
+        mirrored.to_row == squares.to_row &&
+        mirrored.to_col == 4 - squares.to_col &&
+        mirrored.build_row == squares.build_row &&
+        mirrored.build_col == 4 - squares.build_col) {
+      return move.move_id;
+    }
+  }
+  return -1;
+}
+
+// Plays random moves from the start, returning the game and its mirror
+// image. The starting position is symmetric across the middle column.
+void RandomMirroredGames(int num_moves, Board* board, Board* mirror) {
+  for (int i = 0; i < num_moves; ++i) {
+    const std::vector<Board::Move> moves = board->PossibleMoves();
+    ASSERT_FALSE(moves.empty());
+    const int move = moves[rand() % moves.size()].move_id;
+    const int mirror_move = MirrorMove(*board, *mirror, move);
+    ASSERT_NE(mirror_move, -1);
+    ASSERT_TRUE(board->MakeMove(move));
+    ASSERT_TRUE(mirror->MakeMove(mirror_move));
+  }
+}
+
+TEST(OpeningBookTest, CanonicalPosition_SameForMirroredPositions) {
+  srand(3);
+  for (int game = 0; game < 20; ++game) {
+    Board board, mirror;
+    RandomMirroredGames(/*num_moves=*/4, &board, &mirror);
+    EXPECT_EQ(CanonicalPosition(board), CanonicalPosition(mirror));
+  }
+}
+
+TEST(OpeningBookTest, CanonicalPosition_DependsOnPlayerToMove) {
+  Board board;
+  const PackedBoard start = CanonicalPosition(board);
+  board.MakeMove(board.PossibleMoves().front().move_id);
+  EXPECT_NE(CanonicalPosition(board), start);
+}
+
+TEST(OpeningBookTest, ProbeFindsMoveInMirroredPosition) {
+  srand(5);
+  Board board, mirror;
+  RandomMirroredGames(/*num_moves=*/2, &board, &mirror);
+  const int move = board.PossibleMoves().back().move_id;
+
+  int symmetry;
+  BookEntry entry;
+  entry.position = CanonicalPosition(board, &symmetry);
+  entry.move = EncodeBookMove(board, move, symmetry);
+  entry.ply = 2;
+  entry.visits = 1000;
+  entry.win_rate = 0.75;
+
+  // Another position, so that the lookup is a real search.
+  Board other;
+  BookEntry other_entry;
+  other_entry.position = CanonicalPosition(other, &symmetry);
+  other_entry.move = EncodeBookMove(
+      other, other.PossibleMoves().front().move_id, symmetry);
+
+  const std::string path = testing::TempDir() + "/book";
+  ASSERT_TRUE(WriteOpeningBook(path, {entry, other_entry}));
+  std::unique_ptr<OpeningBook> book = OpeningBook::Open(path);
+  ASSERT_NE(book, nullptr);
+  EXPECT_EQ(book->size(), 2);
+
+  BookMove book_move;
+  ASSERT_TRUE(book->Probe(board, &book_move));
+  EXPECT_EQ(book_move.move_id, move);
+  EXPECT_EQ(book_move.visits, 1000);
+  EXPECT_DOUBLE_EQ(book_move.win_rate, 0.75);
+
+  ASSERT_TRUE(book->Probe(mirror, &book_move));
+  EXPECT_EQ(book_move.move_id, MirrorMove(board, mirror, move));
+
+  board.MakeMove(move);
+  EXPECT_FALSE(book->Probe(board, &book_move));
+}
+
+TEST(OpeningBookTest, OpenRejectsOtherFiles) {
+  const std::string path = testing::TempDir() + "/not_a_book";
+  FILE* file = fopen(path.c_str(), "w");
+  ASSERT_NE(file, nullptr);
+  fputs("definitely not an opening book", file);
+  fclose(file);
+  EXPECT_EQ(OpeningBook::Open(path), nullptr);
+  EXPECT_EQ(OpeningBook::Open(path + ".missing"), nullptr);
+}
+
+TEST(OpeningBookTest, OpenRejectsOverflowingEntryCount) {
+  const std::string path = testing::TempDir() + "/corrupt_book";
+  ASSERT_TRUE(WriteOpeningBook(path, {}));
+  ASSERT_NE(OpeningBook::Open(path), nullptr);
+
+  // 2^59 entries of 32 bytes take 2^64 bytes, which wraps around to the
+  // empty file's zero.
+  FILE* file = fopen(path.c_str(), "r+b");
+  ASSERT_NE(file, nullptr);
+  const uint64_t num_entries = uint64_t{1} << 59;
+  ASSERT_EQ(fseek(file, 8, SEEK_SET), 0);
+  ASSERT_EQ(fwrite(&num_entries, sizeof(num_entries), 1, file), 1u);
+  fclose(file);
+  EXPECT_EQ(OpeningBook::Open(path), nullptr);
+}
+
+}  // namespace
+}  // namespace santorini
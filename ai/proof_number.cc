@@ -0,0 +1,207 @@
+#include "ai/proof_number.h"
+
+#include <algorithm>
+
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "game/board.h"
+
+namespace santorini {
+namespace {
+
+// Proof and disproof numbers saturate below kInfinity, which is reserved for
+// proven results.
+constexpr uint32_t kInfinity = 0xffffffff;
+constexpr uint64_t kMaxFinite = kInfinity - 1;
+
+uint32_t SaturatingAdd(uint32_t a, uint32_t b) {
+  if (a == kInfinity || b == kInfinity) return kInfinity;
+  return std::min<uint64_t>(uint64_t{a} + b, kMaxFinite);
+}
+
+}  // namespace
+
+ProofNumberSolver::ProofNumberSolver(const ProofNumberOptions& options)
+    : options_(options) {
+  num_buckets_ = std::max<int64_t>(
+      1, options.memory_bytes / (sizeof(Entry) * kBucketSize));
+  table_.resize(num_buckets_ * kBucketSize);
+}
+
+void ProofNumberSolver::Lookup(uint64_t key, uint32_t* pn,
+                               uint32_t* dn) const {
+  const Entry* bucket = &table_[(key % num_buckets_) * kBucketSize];
+  for (int i = 0; i < kBucketSize; ++i) {
+    // Stored entries never have pn == dn == 0.
+    if (bucket[i].key == key && (bucket[i].pn != 0 || bucket[i].dn != 0)) {
+      *pn = bucket[i].pn;
+      *dn = bucket[i].dn;
+      return;
+    }
+  }
+  *pn = 1;
+  *dn = 1;
+}
+
+void ProofNumberSolver::Store(uint64_t key, uint32_t pn, uint32_t dn,
+                              uint64_t work) {
+  Entry* bucket = &table_[(key % num_buckets_) * kBucketSize];
+  // Overwrite the entry for this key if there is one, otherwise replace the
+  // entry that took the least work.
+  Entry* slot = &bucket[0];
+  for (int i = 0; i < kBucketSize; ++i) {
+    if (bucket[i].key == key) {
+      slot = &bucket[i];
+      break;
+    }
+    if (bucket[i].work < slot->work) {
+      slot = &bucket[i];
+    }
+  }
+  slot->key = key;
+  slot->pn = pn;
+  slot->dn = dn;
+  slot->work = work;
+}
+
+void ProofNumberSolver::Mid(Board* board, uint64_t th_pn, uint64_t th_dn,
+                            int ply) {
+  ++nodes_;
+  const uint64_t key = board->hash();
+  CHECK_LT(ply, kMaxPly);
+  std::vector<Board::Move>& moves = moves_[ply];
+  board->PossibleMoves(&moves);
+
+  // A player without moves loses, and a player that can climb to level 3
+  // wins.
+  if (moves.empty()) {
+    Store(key, kInfinity, 0, 1);
+    return;
+  }
+  for (const Board::Move& move : moves) {
+    if (move.is_winning) {
+      Store(key, 0, kInfinity, 1);
+      return;
+    }
+  }
+
+  const int64_t start_nodes = nodes_;
+  while (true) {
+    // The player to move wins if any child is lost for the opponent, so pn is
+    // the minimum dn of the children and dn is the sum of their pn.
+    uint32_t pn = kInfinity;
+    uint32_t dn = 0;
+    int best_move = -1;
+    uint32_t best_pn = 0;
+    uint32_t best_dn = kInfinity;
+    uint32_t second_dn = kInfinity;
+    for (const Board::Move& move : moves_[ply]) {
+      CHECK(board->MakeMove(move.move_id));
+      uint32_t child_pn, child_dn;
+      Lookup(board->hash(), &child_pn, &child_dn);
+      board->UnmakeMove();
+
+      pn = std::min(pn, child_dn);
+      dn = SaturatingAdd(dn, child_pn);
+      if (best_move == -1 || child_dn < best_dn) {
+        second_dn = best_dn;
+        best_dn = child_dn;
+        best_pn = child_pn;
+        best_move = move.move_id;
+      } else if (child_dn < second_dn) {
+        second_dn = child_dn;
+      }
+    }
+
+    if (pn >= th_pn || dn >= th_dn || nodes_ >= node_limit_) {
+      Store(key, pn, dn, nodes_ - start_nodes + 1);
+      return;
+    }
+
+    // Search the most proving child until either this node's pn would
+    // exceed its threshold, or another child becomes the most proving.
+    const uint64_t child_th_pn = std::min(th_dn - dn + best_pn, kMaxFinite);
+    const uint64_t child_th_dn =
+        std::min<uint64_t>(th_pn, uint64_t{second_dn} + 1);
+    CHECK(board->MakeMove(best_move));
+    Mid(board, child_th_pn, child_th_dn, ply + 1);
+    board->UnmakeMove();
+  }
+}
+
+bool ProofNumberSolver::ProvenLine(Board board, int winner,
+                                   std::vector<int>* line) {
+  while (board.winner() == -1) {
+    const std::vector<Board::Move> moves = board.PossibleMoves();
+    if (moves.empty()) break;
+
+    int next_move = moves.front().move_id;
+    if (board.current_player() == winner) {
+      // Find a move that leaves the opponent lost, re-proving it if the
+      // table has lost the entry.
+      next_move = -1;
+      for (const Board::Move& move : moves) {
+        if (move.is_winning) {
+          next_move = move.move_id;
+          break;
+        }
+      }
+      for (int attempt = 0; attempt < 2 && next_move == -1; ++attempt) {
+        for (const Board::Move& move : moves) {
+          CHECK(board.MakeMove(move.move_id));
+          uint32_t pn, dn;
+          Lookup(board.hash(), &pn, &dn);
+          if (attempt == 1 && pn != 0 && dn != 0) {
+            Mid(&board, kInfinity, kInfinity, 0);
+            Lookup(board.hash(), &pn, &dn);
+          }
+          board.UnmakeMove();
+          if (dn == 0) {
+            next_move = move.move_id;
+            break;
+          }
+        }
+      }
+      // The proof was lost from the table, and couldn't be redone within
+      // the node limit.
+      if (next_move == -1) return false;
+    }
+    line->push_back(next_move);
+    CHECK(board.MakeMove(next_move));
+  }
+  return true;
+}
+
+ProofResult ProofNumberSolver::Solve(const Board& board) {
+  ProofResult result;
+  nodes_ = 0;
+  if (board.winner() != -1) {
+    result.outcome = ProofResult::kLoss;
+    return result;
+  }
+
+  Board search_board = board;
+  node_limit_ = options_.max_nodes;
+  Mid(&search_board, kInfinity, kInfinity, 0);
+  result.nodes = nodes_;
+
+  uint32_t pn, dn;
+  Lookup(board.hash(), &pn, &dn);
+  // Finding the line may need to re-prove positions that were overwritten in
+  // the table, so give it a fresh node budget.
+  node_limit_ = nodes_ + options_.max_nodes;
+  if (pn == 0) {
+    result.outcome = ProofResult::kWin;
+    result.line_truncated =
+        !ProvenLine(board, board.current_player(), &result.line);
+  } else if (dn == 0) {
+    result.outcome = ProofResult::kLoss;
+    result.line_truncated =
+        !ProvenLine(board, 1 - board.current_player(), &result.line);
+  }
+  VLOG(1) << "proof-number search " << result.outcome << " in "
+          << result.nodes << " nodes";
+  return result;
+}
+
+}  // namespace santorini
@@ -0,0 +1,95 @@
+#ifndef SANTORINI_AI_PROOF_NUMBER_H_
+#define SANTORINI_AI_PROOF_NUMBER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "game/board.h"
+
+namespace santorini {
+
+struct ProofNumberOptions {
+  // The memory used by the transposition table.
+  int64_t memory_bytes = int64_t{256} << 20;
+
+  // The search gives up with an unknown result after this many nodes.
+  int64_t max_nodes = 100000000;
+};
+
+struct ProofResult {
+  enum Outcome {
+    // The player to move has a forced win.
+    kWin,
+    // The player to move loses against best play.
+    kLoss,
+    // The search ran out of nodes.
+    kUnknown,
+  };
+  Outcome outcome = kUnknown;
+
+  // For a proven result, a line of play from the position to the end of the
+  // game, in which the winner plays a winning move each turn.
+  std::vector<int> line;
+
+  // Whether `line` stops short of the end of the game. This happens when the
+  // proof of a position on the line was overwritten in the table, and
+  // couldn't be redone within the node limit.
+  bool line_truncated = false;
+
+  // The number of nodes searched.
+  int64_t nodes = 0;
+};
+
+// Decides positions exactly with depth-first proof-number search (df-pn).
+//
+// Santorini has no repeated positions, since every move builds, so the
+// search graph is acyclic and df-pn needs no special handling of cycles.
+// Search results are kept in a fixed size transposition table, which keeps
+// the entries that took the most work when it is full.
+class ProofNumberSolver {
+ public:
+  explicit ProofNumberSolver(const ProofNumberOptions& options = {});
+
+  ProofResult Solve(const Board& board);
+
+ private:
+  // Loses proofs for tests, see ai/proof_number_test.cc.
+  friend class ProofNumberSolverPeer;
+
+  // Proof and disproof numbers, for the proposition that the player to move
+  // wins.
+  struct Entry {
+    uint64_t key = 0;
+    uint32_t pn = 0;
+    uint32_t dn = 0;
+    uint64_t work = 0;
+  };
+
+  static constexpr int kBucketSize = 4;
+  // Games last at most 100 moves, as there are 25 squares with 4 levels.
+  static constexpr int kMaxPly = 101;
+
+  // Searches `board` until its proof number reaches `th_pn` or its disproof
+  // number reaches `th_dn`, and stores the result in the table.
+  void Mid(Board* board, uint64_t th_pn, uint64_t th_dn, int ply);
+
+  // Looks up `key`, returning (1, 1) for unknown positions.
+  void Lookup(uint64_t key, uint32_t* pn, uint32_t* dn) const;
+  void Store(uint64_t key, uint32_t pn, uint32_t dn, uint64_t work);
+
+  // Appends the line of play proving that `board` is won by `winner` to
+  // `line`. Returns false if the line had to stop short.
+  bool ProvenLine(Board board, int winner, std::vector<int>* line);
+
+  ProofNumberOptions options_;
+  std::vector<Entry> table_;
+  uint64_t num_buckets_;
+  int64_t nodes_ = 0;
+  int64_t node_limit_ = 0;
+  // Move lists, by ply, reused to avoid allocating during search.
+  std::vector<Board::Move> moves_[kMaxPly];
+};
+
+}  // namespace santorini
+
+#endif
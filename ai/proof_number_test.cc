@@ -0,0 +1,129 @@
+#include "ai/proof_number.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "game/board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+
+class ProofNumberSolverPeer {
+ public:
+  // Empties the table of `solver`, and leaves it no nodes to redo proofs.
+  static void LoseProofs(ProofNumberSolver* solver) {
+    std::fill(solver->table_.begin(), solver->table_.end(),
+              ProofNumberSolver::Entry());
+    solver->node_limit_ = solver->nodes_;
+  }
+
+  static bool ProvenLine(ProofNumberSolver* solver, const Board& board,
+                         int winner, std::vector<int>* line) {
+    return solver->ProvenLine(board, winner, line);
+  }
+};
+
+namespace {
+
+// Returns +1 if the player to move can force a win within `depth` plies, -1
+// if the opponent can, and 0 otherwise.
+int BruteForce(Board* board, int depth) {
+  if (board->winner() != -1) return -1;
+  const std::vector<Board::Move> moves = board->PossibleMoves();
+  if (moves.empty()) return -1;
+  for (const Board::Move& move : moves) {
+    if (move.is_winning) return 1;
+  }
+  if (depth <= 1) return 0;
+  int best = -1;
+  for (const Board::Move& move : moves) {
+    board->MakeMove(move.move_id);
+    best = std::max(best, -BruteForce(board, depth - 1));
+    board->UnmakeMove();
+    if (best == 1) break;
+  }
+  return best;
+}
+
+// Returns positions a few moves before the end of random games.
+std::vector<Board> LateGamePositions(int num_games, int moves_from_end) {
+  srand(7);
+  std::vector<Board> boards;
+  for (int game = 0; game < num_games; ++game) {
+    Board board;
+    while (board.winner() == -1 && !board.PossibleMoves().empty()) {
+      const std::vector<Board::Move> moves = board.PossibleMoves();
+      board.MakeMove(moves[rand() % moves.size()].move_id);
+    }
+    for (int i = 0; i < moves_from_end && !board.past_moves().empty(); ++i) {
+      board.UnmakeMove();
+    }
+    boards.push_back(board);
+  }
+  return boards;
+}
+
+// Checks that `line` is legal from `board` and ends with a win for `winner`.
+void ExpectLineWins(Board board, const std::vector<int>& line, int winner) {
+  for (int move : line) {
+    ASSERT_TRUE(board.MakeMove(move)) << MoveDebugString(move);
+  }
+  if (board.winner() == -1) {
+    EXPECT_TRUE(board.PossibleMoves().empty());
+    EXPECT_NE(board.current_player(), winner);
+  } else {
+    EXPECT_EQ(board.winner(), winner);
+  }
+}
+
+TEST(ProofNumberTest, AgreesWithBruteForce) {
+  ProofNumberSolver solver(ProofNumberOptions{.memory_bytes = 16 << 20});
+  int num_solved = 0;
+  for (Board board :
+       LateGamePositions(/*num_games=*/30, /*moves_from_end=*/3)) {
+    // Only positions decided within a few moves are quick to solve.
+    const int brute_force = BruteForce(&board, /*depth=*/3);
+    if (brute_force == 0) continue;
+    ++num_solved;
+
+    const ProofResult result = solver.Solve(board);
+    EXPECT_EQ(result.outcome,
+              brute_force == 1 ? ProofResult::kWin : ProofResult::kLoss);
+    const int me = board.current_player();
+    ExpectLineWins(board, result.line,
+                   result.outcome == ProofResult::kWin ? me : 1 - me);
+  }
+  EXPECT_GT(num_solved, 10);
+}
+
+TEST(ProofNumberTest, GivesUpWithoutNodes) {
+  ProofNumberSolver solver(
+      ProofNumberOptions{.memory_bytes = 1 << 20, .max_nodes = 100});
+  const ProofResult result = solver.Solve(Board());
+  EXPECT_EQ(result.outcome, ProofResult::kUnknown);
+  EXPECT_TRUE(result.line.empty());
+}
+
+TEST(ProofNumberTest, LineStopsWhereTheProofIsLost) {
+  // Player 0 loses within four plies, and after player 0's first move,
+  // player 1 can't win right away.
+  const Board board("01110/24220/10B40a2/03221/11b0A20 0");
+  ProofNumberSolver solver(ProofNumberOptions{.memory_bytes = 1 << 20});
+  const ProofResult result = solver.Solve(board);
+  ASSERT_EQ(result.outcome, ProofResult::kLoss);
+  EXPECT_FALSE(result.line_truncated);
+  ExpectLineWins(board, result.line, 1);
+
+  ProofNumberSolverPeer::LoseProofs(&solver);
+  std::vector<int> line;
+  EXPECT_FALSE(
+      ProofNumberSolverPeer::ProvenLine(&solver, board, 1, &line));
+  // The line stops at player 1's move, before which it is still legal.
+  ASSERT_EQ(line.size(), 1);
+  Board after = board;
+  EXPECT_TRUE(after.MakeMove(line[0]));
+}
+
+}  // namespace
+}  // namespace santorini
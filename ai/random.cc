@@ -7,7 +7,7 @@ namespace santorini {
 int RandomAI::SelectMove(const Board& board) {
   std::vector<Board::Move> moves = board.PossibleMoves();
   CHECK(!moves.empty());
-  return moves[rand() % moves.size()].move_id;
+  return moves[rng_() % moves.size()].move_id;
 }
 
 }  // namespace santorini
\ No newline at end of file
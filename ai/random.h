@@ -1,6 +1,10 @@
 #ifndef SANTORINI_AI_RANDOM_H_
 #define SANTORINI_AI_RANDOM_H_
 
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+
 #include "game/board.h"
 #include "game/player.h"
 
@@ -8,9 +12,16 @@ namespace santorini {
 
 class RandomAI : public Player {
  public:
+  // Seeded from rand(), so that srand() makes play repeat.
+  RandomAI() : RandomAI(rand()) {}
+  explicit RandomAI(uint64_t seed) : rng_(seed) {}
+
   int SelectMove(const Board& board) override;
+
+ private:
+  std::mt19937_64 rng_;
 };
 
 }  // namespace santorini
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,93 @@
+// Compares the strength of MCTS with truncated rollouts against MCTS with
+// full rollouts, when both get the same CPU time per move.
+//
+// To run the benchmark:
+//   $ bazel run -c opt ai:rollout_cutoff_benchmark
+//
+// The arguments are the rollout cutoff in plies and the game phase of the
+// corpus positions played from, see game/benchmark_positions.h. Each
+// benchmark iteration is one game from a corpus position, and each position
+// is played twice, with the players swapping sides. The reported counters
+// are:
+//   truncated_win_rate  -- fraction of games won by truncated rollouts.
+//   truncated_iters     -- iterations per move for truncated rollouts.
+//   full_iters          -- iterations per move for full rollouts.
+
+#include <ctime>
+#include <memory>
+#include <vector>
+
+#include "ai/mcts.h"
+#include "benchmark/benchmark.h"
+#include "game/benchmark_positions.h"
+#include "game/board.h"
+#include "game/game_runner.h"
+
+namespace santorini {
+namespace {
+
+// The CPU time budget for each move.
+constexpr double kCpuSecondsPerMove = 0.2;
+
+// The games played for each cutoff and phase, two from each position.
+constexpr int kNumGames = 20;
+
+// Returns the number of iterations `options` runs per CPU second, measured
+// by searching a few corpus positions in `phase`.
+double IterationsPerCpuSecond(MctsOptions options, GamePhase phase) {
+  options.num_iterations = 5000;
+  const std::vector<Board> boards = BenchmarkPositions(phase, /*count=*/4);
+  const std::clock_t start = std::clock();
+  for (const Board& board : boards) {
+    MctsAI ai(board.current_player(), options);
+    ai.SelectMove(board);
+  }
+  const double seconds =
+      static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+  return boards.size() * options.num_iterations / seconds;
+}
+
+static void BM_CutoffStrength(benchmark::State& state) {
+  const GamePhase phase = static_cast<GamePhase>(state.range(1));
+  const std::vector<Board> boards = BenchmarkPositions(phase, kNumGames / 2);
+  MctsOptions full;
+  MctsOptions truncated;
+  truncated.rollout_max_plies = state.range(0);
+  full.num_iterations =
+      IterationsPerCpuSecond(full, phase) * kCpuSecondsPerMove;
+  truncated.num_iterations =
+      IterationsPerCpuSecond(truncated, phase) * kCpuSecondsPerMove;
+
+  int games = 0;
+  int truncated_wins = 0;
+  for (auto _ : state) {
+    const int truncated_player = games % 2;
+    std::vector<std::unique_ptr<Player>> players;
+    for (int player : {0, 1}) {
+      players.push_back(std::make_unique<MctsAI>(
+          player, player == truncated_player ? truncated : full));
+    }
+    GameRunner game_runner(std::move(players),
+                           boards[games / 2 % boards.size()]);
+    if (game_runner.Play() == truncated_player) {
+      ++truncated_wins;
+    }
+    ++games;
+  }
+  state.counters["truncated_win_rate"] =
+      static_cast<double>(truncated_wins) / games;
+  state.counters["truncated_iters"] = truncated.num_iterations;
+  state.counters["full_iters"] = full.num_iterations;
+  state.SetLabel(GamePhaseName(phase));
+}
+BENCHMARK(BM_CutoffStrength)
+    ->ArgsProduct({{4, 8, 16},
+                   benchmark::CreateDenseRange(0, kNumGamePhases - 1,
+                                               /*step=*/1)})
+    ->Iterations(kNumGames)
+    ->Unit(benchmark::kSecond);
+
+}  // namespace
+}  // namespace santorini
+
+BENCHMARK_MAIN();
@@ -0,0 +1,152 @@
+#ifndef SANTORINI_AI_ROLLOUT_POLICY_H_
+#define SANTORINI_AI_ROLLOUT_POLICY_H_
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "game/board.h"
+
+namespace santorini {
+
+// Rollout policies pick the next move to play in an MCTS rollout. They are
+// used as template parameters, so that the policy is inlined into the rollout
+// loop. A policy must provide:
+//
+//   explicit Policy(std::mt19937_64* rng);
+//   int SelectMove(const Board& board, const std::vector<Board::Move>& moves);
+//
+// with SelectMove returning the move_id of one of `moves`, which is never
+// empty. Random choices are drawn from `rng`, the search thread's generator.
+enum class RolloutPolicyType {
+  // Play a winning move if there is one, otherwise play uniformly at random.
+  kRandom,
+  // Like kRandom, but weight the random choice with HeuristicRolloutPolicy.
+  kHeuristic,
+};
+
+class RandomRolloutPolicy {
+ public:
+  explicit RandomRolloutPolicy(std::mt19937_64* rng) : rng_(rng) {}
+
+  int SelectMove(const Board& board, const std::vector<Board::Move>& moves) {
+    for (const auto& move : moves) {
+      if (move.is_winning) return move.move_id;
+    }
+    return moves[(*rng_)() % moves.size()].move_id;
+  }
+
+ private:
+  std::mt19937_64* rng_;
+};
+
+// Plays a winning move if there is one, and otherwise domes a square the
+// opponent could step up to for the win if it can. Other moves are sampled
+// with probability proportional to a weight built from a few rules of thumb:
+// climb when possible, never build a level 3 next to an opponent that could
+// climb it, and don't dome the route up of our own workers.
+class HeuristicRolloutPolicy {
+ public:
+  explicit HeuristicRolloutPolicy(std::mt19937_64* rng) : rng_(rng) {}
+
+  int SelectMove(const Board& board, const std::vector<Board::Move>& moves) {
+    weights_.resize(moves.size());
+    int total_weight = 0;
+    // Once a blocking move is found, only blocking moves are sampled.
+    bool blocking = false;
+    for (size_t i = 0; i < moves.size(); ++i) {
+      if (moves[i].is_winning) return moves[i].move_id;
+      const Board::MoveSquares squares = board.DecodeMove(moves[i].move_id);
+      const bool blocks = Blocks(board, squares);
+      if (blocks && !blocking) {
+        blocking = true;
+        std::fill(weights_.begin(), weights_.begin() + i, 0);
+        total_weight = 0;
+      }
+      if (blocking && !blocks) {
+        weights_[i] = 0;
+        continue;
+      }
+      weights_[i] = std::max(1, kBaseWeight + Score(board, squares));
+      total_weight += weights_[i];
+    }
+    int r = (*rng_)() % total_weight;
+    for (size_t i = 0; i < moves.size(); ++i) {
+      r -= weights_[i];
+      if (r < 0) return moves[i].move_id;
+    }
+    return moves.back().move_id;
+  }
+
+ private:
+  static constexpr int kBaseWeight = 8;
+  static constexpr int kClimbScore = 4;
+  static constexpr int kGiveWinScore = -8;
+  static constexpr int kDomeOwnRouteScore = -4;
+
+  static bool Adjacent(int r1, int c1, int r2, int c2) {
+    return std::abs(r1 - r2) <= 1 && std::abs(c1 - c2) <= 1 &&
+           !(r1 == r2 && c1 == c2);
+  }
+
+  // Whether a worker of `player` standing on level 2 or higher is adjacent to
+  // the given square. If `player` is the one moving, `squares` gives the
+  // position of the worker after the move.
+  static bool HighWorkerAdjacent(const Board& board, int player,
+                                 const Board::MoveSquares& squares, int row,
+                                 int col) {
+    for (int w = 0; w < 2; ++w) {
+      int w_row = board.worker(player, w)[0];
+      int w_col = board.worker(player, w)[1];
+      if (player == board.current_player() && w == squares.worker) {
+        w_row = squares.to_row;
+        w_col = squares.to_col;
+      }
+      if (board.height(w_row, w_col) >= 2 &&
+          Adjacent(w_row, w_col, row, col)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Whether the move domes a level 3 next to a high worker of the opponent.
+  static bool Blocks(const Board& board, const Board::MoveSquares& squares) {
+    return board.height(squares.build_row, squares.build_col) == 3 &&
+           HighWorkerAdjacent(board, 1 - board.current_player(), squares,
+                              squares.build_row, squares.build_col);
+  }
+
+  static int Score(const Board& board, const Board::MoveSquares& squares) {
+    const int me = board.current_player();
+    const int opponent = 1 - me;
+
+    const int climb = board.height(squares.to_row, squares.to_col) -
+                      board.height(squares.from_row, squares.from_col);
+    int score = kClimbScore * climb;
+
+    const int build_height =
+        board.height(squares.build_row, squares.build_col);
+    if (build_height == 3) {
+      if (!Blocks(board, squares) &&
+          HighWorkerAdjacent(board, me, squares, squares.build_row,
+                             squares.build_col)) {
+        score += kDomeOwnRouteScore;
+      }
+    } else if (build_height == 2) {
+      if (HighWorkerAdjacent(board, opponent, squares, squares.build_row,
+                             squares.build_col)) {
+        score += kGiveWinScore;
+      }
+    }
+    return score;
+  }
+
+  std::mt19937_64* rng_;
+  std::vector<int> weights_;
+};
+
+}  // namespace santorini
+
+#endif
@@ -0,0 +1,85 @@
+#include "ai/rollout_policy.h"
+
+#include <random>
+#include <vector>
+
+#include "game/benchmark_positions.h"
+#include "game/board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+namespace {
+
+// Player 0 can climb to level 3.
+constexpr char kWinInOne[] = "11420/342A40/130a30/10B434/41210b 0";
+
+// Player 1's worker on level 2 can climb to the level 3 next to it, unless
+// player 0 domes it. Player 0 can't win right away.
+constexpr char kMustBlock[] = "0a0000/0000A0/002B30/00000/0000b0 0";
+
+bool IsLegal(const Board& board, int move_id) {
+  for (const Board::Move& move : board.PossibleMoves()) {
+    if (move.move_id == move_id) return true;
+  }
+  return false;
+}
+
+// Whether `move_id` builds on the given square.
+bool BuildsOn(const Board& board, int move_id, int row, int col) {
+  const Board::MoveSquares squares = board.DecodeMove(move_id);
+  return squares.build_row == row && squares.build_col == col;
+}
+
+TEST(HeuristicRolloutPolicyTest, PlaysWinningMove) {
+  const Board board(kWinInOne);
+  const std::vector<Board::Move> moves = board.PossibleMoves();
+  std::mt19937_64 rng(1);
+  HeuristicRolloutPolicy policy(&rng);
+  for (int i = 0; i < 100; ++i) {
+    const int move_id = policy.SelectMove(board, moves);
+    Board after = board;
+    ASSERT_TRUE(after.MakeMove(move_id));
+    EXPECT_EQ(after.winner(), 0);
+  }
+}
+
+TEST(HeuristicRolloutPolicyTest, BlocksTheOpponent) {
+  const Board board(kMustBlock);
+  const std::vector<Board::Move> moves = board.PossibleMoves();
+  for (const Board::Move& move : moves) {
+    ASSERT_FALSE(move.is_winning);
+  }
+  std::mt19937_64 rng(1);
+  HeuristicRolloutPolicy policy(&rng);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(BuildsOn(board, policy.SelectMove(board, moves), 2, 3));
+  }
+}
+
+TEST(HeuristicRolloutPolicyTest, PlaysLegalMoves) {
+  std::mt19937_64 rng(1);
+  HeuristicRolloutPolicy policy(&rng);
+  for (const Board& board : BenchmarkPositions()) {
+    const std::vector<Board::Move> moves = board.PossibleMoves();
+    if (moves.empty()) continue;
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_TRUE(IsLegal(board, policy.SelectMove(board, moves)))
+          << board.ToNotation();
+    }
+  }
+}
+
+TEST(RandomRolloutPolicyTest, PlaysWinningMove) {
+  const Board board(kWinInOne);
+  const std::vector<Board::Move> moves = board.PossibleMoves();
+  std::mt19937_64 rng(1);
+  RandomRolloutPolicy policy(&rng);
+  for (int i = 0; i < 100; ++i) {
+    Board after = board;
+    ASSERT_TRUE(after.MakeMove(policy.SelectMove(board, moves)));
+    EXPECT_EQ(after.winner(), 0);
+  }
+}
+
+}  // namespace
+}  // namespace santorini
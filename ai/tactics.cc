@@ -0,0 +1,89 @@
+#include "ai/tactics.h"
+
+#include <vector>
+
+#include "absl/log/check.h"
+#include "game/board.h"
+
+namespace santorini {
+namespace {
+
+bool OnBoard(int row, int col) {
+  return row >= 0 && row < Board::kNumRows && col >= 0 &&
+         col < Board::kNumCols;
+}
+
+TacticalResult Solve(Board* board, int depth, int ply) {
+  if (HasWinningMove(*board)) return TacticalResult::kWin;
+  if (depth <= 1) {
+    return HasAnyMove(*board) ? TacticalResult::kUnknown
+                              : TacticalResult::kLoss;
+  }
+
+  thread_local std::vector<Board::Move> move_buffers[kMaxTacticalDepth];
+  std::vector<Board::Move>& moves = move_buffers[ply];
+  board->PossibleMoves(&moves);
+  if (moves.empty()) return TacticalResult::kLoss;
+
+  // The player to move wins if any move leaves the opponent lost, and loses
+  // if every move leaves the opponent won.
+  bool all_lost = true;
+  for (const Board::Move& move : moves) {
+    CHECK(board->MakeMove(move.move_id));
+    const TacticalResult result = Solve(board, depth - 1, ply + 1);
+    board->UnmakeMove();
+    if (result == TacticalResult::kLoss) return TacticalResult::kWin;
+    if (result != TacticalResult::kWin) all_lost = false;
+  }
+  return all_lost ? TacticalResult::kLoss : TacticalResult::kUnknown;
+}
+
+}  // namespace
+
+bool HasWinningMove(const Board& board) {
+  const int player = board.current_player();
+  for (int worker : {0, 1}) {
+    const int row = board.worker(player, worker)[0];
+    const int col = board.worker(player, worker)[1];
+    if (board.height(row, col) != 2) continue;
+    for (int dr = -1; dr <= 1; ++dr) {
+      for (int dc = -1; dc <= 1; ++dc) {
+        const int r = row + dr;
+        const int c = col + dc;
+        // Moving up always leaves the vacated square to build on.
+        if (OnBoard(r, c) && board.height(r, c) == 3 && !board.occupied(r, c)) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+bool HasAnyMove(const Board& board) {
+  const int player = board.current_player();
+  for (int worker : {0, 1}) {
+    const int row = board.worker(player, worker)[0];
+    const int col = board.worker(player, worker)[1];
+    const int h = board.height(row, col);
+    for (int dr = -1; dr <= 1; ++dr) {
+      for (int dc = -1; dc <= 1; ++dc) {
+        const int r = row + dr;
+        const int c = col + dc;
+        if (OnBoard(r, c) && !board.occupied(r, c) &&
+            board.height(r, c) <= h + 1 && board.height(r, c) < 4) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+TacticalResult SolveShallow(Board* board, int depth) {
+  CHECK_LE(depth, kMaxTacticalDepth);
+  if (board->winner() != -1) return TacticalResult::kLoss;
+  return Solve(board, depth, 0);
+}
+
+}  // namespace santorini
@@ -0,0 +1,36 @@
+#ifndef SANTORINI_AI_TACTICS_H_
+#define SANTORINI_AI_TACTICS_H_
+
+#include "game/board.h"
+
+namespace santorini {
+
+// The outcome of a shallow search, for the player to move.
+enum class TacticalResult {
+  kUnknown,
+  kWin,
+  kLoss,
+};
+
+// The maximum depth supported by SolveShallow.
+constexpr int kMaxTacticalDepth = 8;
+
+// Returns true if the player to move can climb to level 3 right now.
+// This is much cheaper than generating all moves.
+bool HasWinningMove(const Board& board);
+
+// Returns true if the player to move has any move.
+bool HasAnyMove(const Board& board);
+
+// Searches all moves up to `depth` plies from `board` for a forced win or
+// loss of the player to move. Only the end of the game is scored, so the
+// result is exact when it isn't kUnknown. `board` is restored before
+// returning.
+//
+// Move lists are kept in thread-local buffers, so that the search doesn't
+// allocate once warmed up.
+TacticalResult SolveShallow(Board* board, int depth);
+
+}  // namespace santorini
+
+#endif
@@ -0,0 +1,113 @@
+#include "ai/tactics.h"
+
+#include <string>
+#include <vector>
+
+#include "ai/proof_number.h"
+#include "game/benchmark_positions.h"
+#include "game/board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+namespace {
+
+// Player 0 can climb to level 3.
+constexpr char kWinInOne[] = "11420/342A40/130a30/10B434/41210b 0";
+
+// Player 0 can't climb to level 3, but can leave player 1 without moves.
+constexpr char kWinInTwo[] = "22321/40A433/44130B/43444/11a331b 0";
+
+// Player 0 wins on their second move, whatever player 1 does.
+constexpr char kWinInThree[] = "0A1a220/34140/13030/10B433/30110b 0";
+
+// Every move of player 1 lets player 0 climb to level 3.
+constexpr char kLossInTwo[] = "11420/342A40/130a30/10B433/4121b0 1";
+
+// Player 1 has no move.
+constexpr char kNoMove[] = "22321/40A433/44130B/44444/1a1331b 1";
+
+// Returns SolveShallow(board, depth), checking that it restores `board`.
+TacticalResult Solve(Board board, int depth) {
+  const std::string notation = board.ToNotation();
+  const size_t num_moves = board.past_moves().size();
+  const TacticalResult result = SolveShallow(&board, depth);
+  EXPECT_EQ(board.ToNotation(), notation);
+  EXPECT_EQ(board.past_moves().size(), num_moves);
+  return result;
+}
+
+TEST(TacticsTest, WinInOne) {
+  const Board board(kWinInOne);
+  EXPECT_TRUE(HasWinningMove(board));
+  EXPECT_TRUE(HasAnyMove(board));
+  for (int depth = 1; depth <= 4; ++depth) {
+    EXPECT_EQ(Solve(board, depth), TacticalResult::kWin) << depth;
+  }
+}
+
+TEST(TacticsTest, WinInTwo) {
+  const Board board(kWinInTwo);
+  EXPECT_FALSE(HasWinningMove(board));
+  EXPECT_EQ(Solve(board, 1), TacticalResult::kUnknown);
+  for (int depth = 2; depth <= 4; ++depth) {
+    EXPECT_EQ(Solve(board, depth), TacticalResult::kWin) << depth;
+  }
+}
+
+TEST(TacticsTest, WinInThree) {
+  const Board board(kWinInThree);
+  EXPECT_FALSE(HasWinningMove(board));
+  EXPECT_EQ(Solve(board, 1), TacticalResult::kUnknown);
+  EXPECT_EQ(Solve(board, 2), TacticalResult::kUnknown);
+  EXPECT_EQ(Solve(board, 3), TacticalResult::kWin);
+  EXPECT_EQ(Solve(board, 4), TacticalResult::kWin);
+}
+
+TEST(TacticsTest, LossInTwo) {
+  const Board board(kLossInTwo);
+  EXPECT_FALSE(HasWinningMove(board));
+  EXPECT_TRUE(HasAnyMove(board));
+  EXPECT_EQ(Solve(board, 1), TacticalResult::kUnknown);
+  EXPECT_EQ(Solve(board, 2), TacticalResult::kLoss);
+  EXPECT_EQ(Solve(board, 3), TacticalResult::kLoss);
+}
+
+TEST(TacticsTest, NoMove) {
+  const Board board(kNoMove);
+  EXPECT_FALSE(HasWinningMove(board));
+  EXPECT_FALSE(HasAnyMove(board));
+  EXPECT_EQ(Solve(board, 1), TacticalResult::kLoss);
+  EXPECT_EQ(Solve(board, 3), TacticalResult::kLoss);
+}
+
+TEST(TacticsTest, AgreesWithMoveGeneration) {
+  for (const Board& board : BenchmarkPositions()) {
+    bool winning = false;
+    for (const Board::Move& move : board.PossibleMoves()) {
+      winning |= move.is_winning;
+    }
+    EXPECT_EQ(HasWinningMove(board), winning) << board.ToNotation();
+    EXPECT_EQ(HasAnyMove(board), !board.PossibleMoves().empty())
+        << board.ToNotation();
+  }
+}
+
+// Results that aren't kUnknown are exact, so they must agree with the
+// proof-number solver.
+TEST(TacticsTest, AgreesWithProofNumberSolver) {
+  ProofNumberSolver solver(ProofNumberOptions{.memory_bytes = 16 << 20});
+  int num_decided = 0;
+  for (const Board& board : BenchmarkPositions(GamePhase::kEndgame)) {
+    const TacticalResult result = Solve(board, 3);
+    if (result == TacticalResult::kUnknown) continue;
+    ++num_decided;
+    EXPECT_EQ(solver.Solve(board).outcome, result == TacticalResult::kWin
+                                               ? ProofResult::kWin
+                                               : ProofResult::kLoss)
+        << board.ToNotation();
+  }
+  EXPECT_GT(num_decided, 5);
+}
+
+}  // namespace
+}  // namespace santorini
@@ -0,0 +1,351 @@
+#include "ai/training_data.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "game/board.h"
+#include "game/packed_board.h"
+
+namespace santorini {
+namespace {
+
+constexpr char kMagic[8] = {'S', 'N', 'T', 'R', 'E', 'C', '0', '2'};
+constexpr uint32_t kCompressedFlag = 1;
+constexpr size_t kFileHeaderSize = sizeof(kMagic) + sizeof(uint32_t);
+constexpr size_t kBlockHeaderSize = 2 * sizeof(uint32_t);
+
+// The used bits of a PackedBoard.
+constexpr int kPositionBytes = PackedBoard::kNumBits / 8;
+
+// Move ids, as in Board::PossibleMoveMask().
+constexpr int kNumMoveIds = 128;
+
+void PutVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+// Reads a varint from [*pos, end). Returns false if it runs past the end.
+bool GetVarint(const uint8_t** pos, const uint8_t* end, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; *pos < end && shift < 64; shift += 7) {
+    const uint8_t byte = *(*pos)++;
+    *value |= uint64_t{byte & 0x7fu} << shift;
+    if (byte < 0x80) return true;
+  }
+  return false;
+}
+
+void PutUint32(uint32_t value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+uint32_t GetUint32(const uint8_t* in) {
+  uint32_t value;
+  memcpy(&value, in, sizeof(value));
+  return value;
+}
+
+// Appends `record` to `out`, using `payload` as scratch space.
+void SerializeRecord(const TrainingRecord& record, std::string* payload,
+                     std::string* out) {
+  const uint64_t words[2] = {record.position.low(), record.position.high()};
+  static_assert(kPositionBytes <= sizeof(words));
+  payload->assign(reinterpret_cast<const char*>(words), kPositionBytes);
+  PutVarint(record.ply, payload);
+  payload->push_back(static_cast<char>(record.winner));
+  PutVarint(record.visits.size(), payload);
+  for (const TrainingRecord::MoveVisits& move : record.visits) {
+    payload->push_back(static_cast<char>(move.move_id));
+    PutVarint(move.visits, payload);
+  }
+  PutVarint(payload->size(), out);
+  out->append(*payload);
+}
+
+// Returns whether `position` could be a position of a game: heights of at
+// most 4, and workers on distinct squares of the board.
+bool IsValidPosition(const PackedBoard& position) {
+  for (int square = 0; square < PackedBoard::kNumSquares; ++square) {
+    if (position.height(square) > 4) return false;
+  }
+  int squares[4];
+  for (int i = 0; i < 4; ++i) {
+    squares[i] = position.worker(i / 2, i % 2);
+    if (squares[i] >= PackedBoard::kNumSquares) return false;
+    for (int j = 0; j < i; ++j) {
+      if (squares[j] == squares[i]) return false;
+    }
+  }
+  return true;
+}
+
+// Parses the record in [pos, end). Returns false if it is malformed or holds
+// an impossible position or move id, so that readers can index by them
+// without checking.
+bool ParseRecord(const uint8_t* pos, const uint8_t* end,
+                 TrainingRecord* record) {
+  if (end - pos < kPositionBytes) return false;
+  uint64_t words[2] = {0, 0};
+  memcpy(words, pos, kPositionBytes);
+  record->position = PackedBoard::FromWords(words[0], words[1]);
+  if (!IsValidPosition(record->position)) return false;
+  pos += kPositionBytes;
+
+  uint64_t ply, num_moves;
+  if (!GetVarint(&pos, end, &ply) || pos == end) return false;
+  record->ply = ply;
+  record->winner = static_cast<int8_t>(*pos++);
+  if (!GetVarint(&pos, end, &num_moves) || num_moves > kNumMoveIds) {
+    return false;
+  }
+  record->visits.resize(num_moves);
+  for (TrainingRecord::MoveVisits& move : record->visits) {
+    uint64_t visits;
+    if (pos == end) return false;
+    move.move_id = *pos++;
+    if (move.move_id >= kNumMoveIds) return false;
+    if (!GetVarint(&pos, end, &visits)) return false;
+    move.visits = visits;
+  }
+  return pos == end;
+}
+
+}  // namespace
+
+void SetPosition(const Board& board, TrainingRecord* record) {
+  record->position = PackedBoard(board);
+  record->ply = board.past_moves().size();
+}
+
+std::unique_ptr<RecordWriter> RecordWriter::Open(
+    const std::string& path, const RecordWriterOptions& options) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    LOG(ERROR) << "Can't write records " << path << ": " << strerror(errno);
+    return nullptr;
+  }
+  std::string header(kMagic, sizeof(kMagic));
+  PutUint32(options.compress ? kCompressedFlag : 0, &header);
+  if (fwrite(header.data(), header.size(), 1, file) != 1) {
+    LOG(ERROR) << "Failed writing records " << path;
+    fclose(file);
+    return nullptr;
+  }
+  return std::unique_ptr<RecordWriter>(new RecordWriter(file, path, options));
+}
+
+RecordWriter::RecordWriter(FILE* file, const std::string& path,
+                           const RecordWriterOptions& options)
+    : file_(file), path_(path), options_(options) {
+  block_.data.reserve(options_.block_size + 1024);
+  thread_ = std::thread([this]() { WriteBlocks(); });
+}
+
+RecordWriter::~RecordWriter() {
+  FlushBlock();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+  }
+  ready_.notify_one();
+  thread_.join();
+  if (fclose(file_) != 0) {
+    LOG(ERROR) << "Failed writing records " << path_;
+  }
+  if (records_dropped_ > 0) {
+    LOG(WARNING) << "Dropped " << records_dropped_ << " of "
+                 << records_written_ << " records for " << path_;
+  }
+}
+
+void RecordWriter::Write(const TrainingRecord& record) {
+  SerializeRecord(record, &payload_, &block_.data);
+  ++block_.num_records;
+  ++records_written_;
+  if (block_.data.size() >= options_.block_size) FlushBlock();
+}
+
+int64_t RecordWriter::records_dropped() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return records_dropped_;
+}
+
+void RecordWriter::FlushBlock() {
+  if (block_.num_records == 0) return;
+  Block block;
+  block.data.reserve(options_.block_size + 1024);
+  std::swap(block, block_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_bytes_ + block.data.size() > options_.max_pending_bytes) {
+      if (records_dropped_ == 0) {
+        LOG(WARNING) << "Disk can't keep up with records for " << path_
+                     << ", dropping blocks";
+      }
+      records_dropped_ += block.num_records;
+      return;
+    }
+    pending_bytes_ += block.data.size();
+    pending_.push_back(std::move(block));
+  }
+  ready_.notify_one();
+}
+
+void RecordWriter::WriteBlocks() {
+  std::string compressed;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    ready_.wait(lock, [this]() { return closing_ || !pending_.empty(); });
+    if (pending_.empty()) return;
+    Block block = std::move(pending_.front());
+    pending_.pop_front();
+    lock.unlock();
+
+    const std::string* stored = &block.data;
+    if (options_.compress) {
+      uLongf compressed_size = compressBound(block.data.size());
+      compressed.resize(compressed_size);
+      CHECK_EQ(compress2(reinterpret_cast<Bytef*>(compressed.data()),
+                         &compressed_size,
+                         reinterpret_cast<const Bytef*>(block.data.data()),
+                         block.data.size(), Z_BEST_SPEED),
+               Z_OK);
+      compressed.resize(compressed_size);
+      stored = &compressed;
+    }
+    std::string header;
+    PutUint32(block.data.size(), &header);
+    PutUint32(stored->size(), &header);
+    const bool ok =
+        fwrite(header.data(), header.size(), 1, file_) == 1 &&
+        fwrite(stored->data(), stored->size(), 1, file_) == 1;
+
+    lock.lock();
+    pending_bytes_ -= block.data.size();
+    if (!ok) {
+      LOG(ERROR) << "Failed writing records " << path_ << ": "
+                 << strerror(errno);
+      records_dropped_ += block.num_records;
+    }
+  }
+}
+
+std::unique_ptr<RecordReader> RecordReader::Open(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Can't open records " << path << ": " << strerror(errno);
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < kFileHeaderSize) {
+    LOG(ERROR) << "Records " << path << " are truncated";
+    close(fd);
+    return nullptr;
+  }
+  const size_t length = st.st_size;
+  void* data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "Can't map records " << path << ": " << strerror(errno);
+    return nullptr;
+  }
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  const uint32_t flags = GetUint32(bytes + sizeof(kMagic));
+  if (memcmp(bytes, kMagic, sizeof(kMagic)) != 0 ||
+      (flags & ~kCompressedFlag) != 0) {
+    LOG(ERROR) << path << " is not a record file of this version";
+    munmap(data, length);
+    return nullptr;
+  }
+  // The file is read once, front to back.
+  madvise(data, length, MADV_SEQUENTIAL);
+  return std::unique_ptr<RecordReader>(
+      new RecordReader(path, bytes, length, flags & kCompressedFlag));
+}
+
+RecordReader::RecordReader(const std::string& path, const uint8_t* data,
+                           size_t length, bool compressed)
+    : path_(path),
+      data_(data),
+      length_(length),
+      compressed_(compressed),
+      offset_(kFileHeaderSize) {}
+
+RecordReader::~RecordReader() {
+  munmap(const_cast<uint8_t*>(data_), length_);
+}
+
+bool RecordReader::NextBlock() {
+  block_.clear();
+  block_offset_ = 0;
+  if (offset_ == length_) return false;
+  // On errors, skip to the end of the file.
+  const size_t offset = offset_;
+  offset_ = length_;
+  if (length_ - offset < kBlockHeaderSize) {
+    LOG(ERROR) << "Records " << path_ << " are truncated";
+    return false;
+  }
+  const uint32_t raw_size = GetUint32(data_ + offset);
+  const uint32_t stored_size = GetUint32(data_ + offset + sizeof(uint32_t));
+  const uint8_t* stored = data_ + offset + kBlockHeaderSize;
+  if (length_ - offset - kBlockHeaderSize < stored_size) {
+    LOG(ERROR) << "Records " << path_ << " are truncated";
+    return false;
+  }
+
+  block_.resize(raw_size);
+  bool ok;
+  if (compressed_) {
+    uLongf size = raw_size;
+    ok = uncompress(reinterpret_cast<Bytef*>(block_.data()), &size, stored,
+                    stored_size) == Z_OK &&
+         size == raw_size;
+  } else {
+    ok = stored_size == raw_size;
+    if (ok) memcpy(block_.data(), stored, raw_size);
+  }
+  if (!ok) {
+    LOG(ERROR) << "Records " << path_ << " are corrupt";
+    block_.clear();
+    return false;
+  }
+  offset_ = offset + kBlockHeaderSize + stored_size;
+  return true;
+}
+
+bool RecordReader::Next(TrainingRecord* record) {
+  while (block_offset_ == block_.size()) {
+    if (!NextBlock()) return false;
+  }
+  const auto* begin = reinterpret_cast<const uint8_t*>(block_.data());
+  const uint8_t* pos = begin + block_offset_;
+  const uint8_t* end = begin + block_.size();
+  uint64_t size;
+  if (!GetVarint(&pos, end, &size) || static_cast<uint64_t>(end - pos) < size ||
+      !ParseRecord(pos, pos + size, record)) {
+    LOG(ERROR) << "Records " << path_ << " are corrupt";
+    offset_ = length_;
+    block_.clear();
+    block_offset_ = 0;
+    return false;
+  }
+  block_offset_ = pos + size - begin;
+  return true;
+}
+
+}  // namespace santorini
@@ -0,0 +1,150 @@
+#ifndef SANTORINI_AI_TRAINING_DATA_H_
+#define SANTORINI_AI_TRAINING_DATA_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game/board.h"
+#include "game/packed_board.h"
+
+namespace santorini {
+
+// A position from a self-play game, with what the search made of it and how
+// the game ended.
+struct TrainingRecord {
+  PackedBoard position;
+  // The number of moves played before the position.
+  int ply = 0;
+  // The winner of the game.
+  int winner = -1;
+  // The visits of each root move by the search that picked the move played.
+  struct MoveVisits {
+    int move_id = 0;
+    int visits = 0;
+  };
+  std::vector<MoveVisits> visits;
+};
+
+// Sets the position of `record` to that of `board`.
+void SetPosition(const Board& board, TrainingRecord* record);
+
+struct RecordWriterOptions {
+  // Compress each block with zlib.
+  bool compress = true;
+
+  // Records are gathered into blocks of about this many bytes, which are
+  // compressed and written as one.
+  size_t block_size = 1 << 20;
+
+  // If the disk falls this far behind, blocks are dropped rather than
+  // making Write wait.
+  size_t max_pending_bytes = size_t{256} << 20;
+};
+
+// Writes records to a file from a background thread.
+//
+// The file is an 8 byte magic and 4 byte flags, followed by blocks, each a
+// 4 byte raw size, a 4 byte stored size and the stored bytes, which are the
+// raw bytes compressed with zlib if the flags say so. The raw bytes are a
+// sequence of records, each prefixed with its length as a varint. Records
+// hold the 96 bits of the packed position in 12 bytes, and a few bytes per
+// root move, so early positions take about 100 bytes compressed and late
+// ones much less.
+//
+// Write only serializes into memory; the I/O and compression happen on the
+// writer's own thread, so search never waits on the disk. Use one writer
+// per thread, writing to its own shard: Write is not thread-safe.
+class RecordWriter {
+ public:
+  // Creates `path`. Returns null, and logs why, on failure.
+  static std::unique_ptr<RecordWriter> Open(
+      const std::string& path, const RecordWriterOptions& options = {});
+
+  // Writes out everything that is buffered, and closes the file.
+  ~RecordWriter();
+
+  RecordWriter(const RecordWriter&) = delete;
+  RecordWriter& operator=(const RecordWriter&) = delete;
+
+  void Write(const TrainingRecord& record);
+
+  int64_t records_written() const { return records_written_; }
+  // Records lost because the disk couldn't keep up, or to write errors.
+  int64_t records_dropped() const;
+
+ private:
+  struct Block {
+    std::string data;
+    int64_t num_records = 0;
+  };
+
+  RecordWriter(FILE* file, const std::string& path,
+               const RecordWriterOptions& options);
+
+  // Hands the current block to the I/O thread.
+  void FlushBlock();
+
+  // The I/O thread.
+  void WriteBlocks();
+
+  FILE* file_;
+  std::string path_;
+  RecordWriterOptions options_;
+  Block block_;
+  std::string payload_;
+  int64_t records_written_ = 0;
+
+  mutable std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<Block> pending_;
+  size_t pending_bytes_ = 0;
+  int64_t records_dropped_ = 0;
+  bool closing_ = false;
+  std::thread thread_;
+};
+
+// Reads the records of a file written by RecordWriter, memory-mapped.
+class RecordReader {
+ public:
+  // Maps the file at `path`. Returns null, and logs why, if the file can't be
+  // read or isn't a record file.
+  static std::unique_ptr<RecordReader> Open(const std::string& path);
+
+  ~RecordReader();
+
+  RecordReader(const RecordReader&) = delete;
+  RecordReader& operator=(const RecordReader&) = delete;
+
+  // Reads the next record. Returns false at the end of the file, or if the
+  // rest of it is corrupt, which is logged.
+  bool Next(TrainingRecord* record);
+
+ private:
+  RecordReader(const std::string& path, const uint8_t* data, size_t length,
+               bool compressed);
+
+  // Loads the next block into block_. Returns false at the end.
+  bool NextBlock();
+
+  std::string path_;
+  const uint8_t* data_;
+  size_t length_;
+  bool compressed_;
+  // The offset of the next block in the file.
+  size_t offset_;
+  // The current block, and the offset of the next record in it.
+  std::string block_;
+  size_t block_offset_ = 0;
+};
+
+}  // namespace santorini
+
+#endif
@@ -0,0 +1,142 @@
+#include "ai/training_data.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "game/board.h"
+#include "game/packed_board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+namespace {
+
+// Returns records for the positions of a game of random moves.
+std::vector<TrainingRecord> RandomGameRecords(int seed) {
+  srand(seed);
+  std::vector<TrainingRecord> records;
+  Board board;
+  while (board.winner() == -1) {
+    const std::vector<Board::Move> moves = board.PossibleMoves();
+    if (moves.empty()) break;
+    TrainingRecord record;
+    SetPosition(board, &record);
+    for (const Board::Move& move : moves) {
+      record.visits.push_back({move.move_id, rand() % 100000});
+    }
+    records.push_back(record);
+    board.MakeMove(moves[rand() % moves.size()].move_id);
+  }
+  for (TrainingRecord& record : records) record.winner = seed % 2;
+  return records;
+}
+
+void ExpectEqual(const TrainingRecord& a, const TrainingRecord& b) {
+  EXPECT_EQ(a.position, b.position);
+  EXPECT_EQ(a.ply, b.ply);
+  EXPECT_EQ(a.winner, b.winner);
+  ASSERT_EQ(a.visits.size(), b.visits.size());
+  for (size_t i = 0; i < a.visits.size(); ++i) {
+    EXPECT_EQ(a.visits[i].move_id, b.visits[i].move_id);
+    EXPECT_EQ(a.visits[i].visits, b.visits[i].visits);
+  }
+}
+
+class RoundTripTest : public testing::TestWithParam<bool> {};
+
+TEST_P(RoundTripTest, ReadsBackWhatWasWritten) {
+  const std::string path = testing::TempDir() + "/records";
+  std::vector<TrainingRecord> records;
+  for (int seed = 0; seed < 20; ++seed) {
+    for (const TrainingRecord& record : RandomGameRecords(seed)) {
+      records.push_back(record);
+    }
+  }
+  {
+    // Small blocks, so that records span several of them.
+    auto writer = RecordWriter::Open(
+        path, {.compress = GetParam(), .block_size = 1000});
+    ASSERT_NE(writer, nullptr);
+    for (const TrainingRecord& record : records) writer->Write(record);
+  }
+
+  auto reader = RecordReader::Open(path);
+  ASSERT_NE(reader, nullptr);
+  TrainingRecord record;
+  for (const TrainingRecord& expected : records) {
+    ASSERT_TRUE(reader->Next(&record));
+    ExpectEqual(record, expected);
+  }
+  EXPECT_FALSE(reader->Next(&record));
+}
+
+INSTANTIATE_TEST_SUITE_P(Compression, RoundTripTest, testing::Bool());
+
+TEST(TrainingDataTest, StopsAtTruncatedBlock) {
+  const std::string path = testing::TempDir() + "/truncated_records";
+  {
+    auto writer = RecordWriter::Open(path);
+    ASSERT_NE(writer, nullptr);
+    for (const TrainingRecord& record : RandomGameRecords(1)) {
+      writer->Write(record);
+    }
+  }
+  FILE* file = fopen(path.c_str(), "r+b");
+  ASSERT_NE(file, nullptr);
+  fseek(file, 0, SEEK_END);
+  ASSERT_EQ(ftruncate(fileno(file), ftell(file) - 1), 0);
+  fclose(file);
+
+  auto reader = RecordReader::Open(path);
+  ASSERT_NE(reader, nullptr);
+  TrainingRecord record;
+  EXPECT_FALSE(reader->Next(&record));
+  EXPECT_FALSE(reader->Next(&record));
+}
+
+TEST(TrainingDataTest, RejectsCorruptRecords) {
+  const std::string path = testing::TempDir() + "/corrupt_records";
+  const int heights[PackedBoard::kNumSquares] = {};
+  const int workers[2][2] = {{6, 8}, {16, 18}};
+  const TrainingRecord valid = {.position = PackedBoard(heights, workers, 0),
+                                .winner = 0,
+                                .visits = {{.move_id = 5, .visits = 10}}};
+
+  std::vector<TrainingRecord> corrupt_records;
+  int too_high[PackedBoard::kNumSquares] = {};
+  too_high[12] = 5;
+  corrupt_records.push_back(valid);
+  corrupt_records.back().position = PackedBoard(too_high, workers, 0);
+  const int off_board[2][2] = {{6, 8}, {16, 25}};
+  corrupt_records.push_back(valid);
+  corrupt_records.back().position = PackedBoard(heights, off_board, 0);
+  const int shared[2][2] = {{6, 8}, {8, 18}};
+  corrupt_records.push_back(valid);
+  corrupt_records.back().position = PackedBoard(heights, shared, 0);
+  corrupt_records.push_back(valid);
+  corrupt_records.back().visits[0].move_id = 128;
+
+  for (const TrainingRecord& corrupt : corrupt_records) {
+    {
+      auto writer = RecordWriter::Open(path);
+      ASSERT_NE(writer, nullptr);
+      writer->Write(valid);
+      writer->Write(corrupt);
+      writer->Write(valid);
+    }
+    auto reader = RecordReader::Open(path);
+    ASSERT_NE(reader, nullptr);
+    TrainingRecord record;
+    ASSERT_TRUE(reader->Next(&record));
+    ExpectEqual(record, valid);
+    EXPECT_FALSE(reader->Next(&record));
+    EXPECT_FALSE(reader->Next(&record));
+  }
+}
+
+}  // namespace
+}  // namespace santorini
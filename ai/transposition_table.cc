@@ -0,0 +1,62 @@
+#include "ai/transposition_table.h"
+
+#include "absl/log/check.h"
+
+namespace santorini {
+namespace {
+
+// Data layout, from the lowest bit:
+//   32 bits -- score
+//    8 bits -- move + 1, so that no move is 0
+//    8 bits -- depth + 1, so that no depth is 0
+//    8 bits -- bound
+uint64_t Pack(int depth, int score, Bound bound, int move) {
+  return static_cast<uint64_t>(static_cast<uint32_t>(score)) |
+         static_cast<uint64_t>(static_cast<uint8_t>(move + 1)) << 32 |
+         static_cast<uint64_t>(static_cast<uint8_t>(depth + 1)) << 40 |
+         static_cast<uint64_t>(bound) << 48;
+}
+
+void Unpack(uint64_t data, TTEntry* entry) {
+  entry->score = static_cast<int32_t>(static_cast<uint32_t>(data));
+  entry->move = static_cast<int16_t>((data >> 32) & 0xff) - 1;
+  entry->depth = static_cast<int8_t>(((data >> 40) & 0xff) - 1);
+  entry->bound = static_cast<Bound>((data >> 48) & 0xff);
+}
+
+}  // namespace
+
+TranspositionTable::TranspositionTable(int size_bits)
+    : mask_((uint64_t{1} << size_bits) - 1) {
+  CHECK_GT(size_bits, 0);
+  CHECK_LT(size_bits, 40);
+  slots_ = std::make_unique<Slot[]>(uint64_t{1} << size_bits);
+}
+
+bool TranspositionTable::Probe(uint64_t key, TTEntry* entry) const {
+  const Slot& slot = slots_[key & mask_];
+  const uint64_t data = slot.data.load(std::memory_order_relaxed);
+  const uint64_t key_xor_data =
+      slot.key_xor_data.load(std::memory_order_relaxed);
+  if (data == 0 || (key_xor_data ^ data) != key) return false;
+  entry->key = key;
+  Unpack(data, entry);
+  return entry->bound != Bound::kNone;
+}
+
+void TranspositionTable::Store(uint64_t key, int depth, int score, Bound bound,
+                               int move) {
+  Slot& slot = slots_[key & mask_];
+  const uint64_t data = Pack(depth, score, bound, move);
+  slot.key_xor_data.store(key ^ data, std::memory_order_relaxed);
+  slot.data.store(data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::Clear() {
+  for (uint64_t i = 0; i <= mask_; ++i) {
+    slots_[i].key_xor_data.store(0, std::memory_order_relaxed);
+    slots_[i].data.store(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace santorini
@@ -0,0 +1,65 @@
+#ifndef SANTORINI_AI_TRANSPOSITION_TABLE_H_
+#define SANTORINI_AI_TRANSPOSITION_TABLE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace santorini {
+
+// How a stored score relates to the true score of a position.
+enum class Bound : uint8_t {
+  kNone = 0,
+  // The score is exact.
+  kExact,
+  // The true score is at least the stored score (a beta cutoff).
+  kLower,
+  // The true score is at most the stored score (no move raised alpha).
+  kUpper,
+};
+
+struct TTEntry {
+  uint64_t key = 0;
+  int32_t score = 0;
+  int16_t move = -1;
+  int8_t depth = -1;
+  Bound bound = Bound::kNone;
+};
+
+// A hash table of search results keyed by Board::hash(), that can be shared
+// by several search threads without locking.
+//
+// Each slot is 16 bytes: the entry packed into 64 bits of data, and the key
+// xor-ed with the data. A reader that sees a slot torn by a concurrent
+// writer gets a key that doesn't verify, and treats it as a miss. A new
+// entry always replaces the old one.
+class TranspositionTable {
+ public:
+  // Creates a table with 2^size_bits entries.
+  explicit TranspositionTable(int size_bits);
+
+  // Returns true and fills `entry` if there is an entry for `key`.
+  bool Probe(uint64_t key, TTEntry* entry) const;
+
+  void Store(uint64_t key, int depth, int score, Bound bound, int move);
+
+  // Not safe to call concurrently with Probe or Store.
+  void Clear();
+
+ private:
+  // Tears slots for tests, see ai/transposition_table_test.cc.
+  friend class TranspositionTablePeer;
+
+  struct alignas(16) Slot {
+    std::atomic<uint64_t> key_xor_data{0};
+    std::atomic<uint64_t> data{0};
+  };
+  static_assert(sizeof(Slot) == 16);
+
+  std::unique_ptr<Slot[]> slots_;
+  uint64_t mask_;
+};
+
+}  // namespace santorini
+
+#endif
@@ -0,0 +1,82 @@
+#include "ai/transposition_table.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+namespace santorini {
+
+class TranspositionTablePeer {
+ public:
+  // Copies the data of the slot for `key` in `from` over that of `to`,
+  // keeping the key check of `to`, as a reader racing a writer may see it.
+  static void TearSlot(uint64_t key, const TranspositionTable& from,
+                       TranspositionTable* to) {
+    const uint64_t index = key & to->mask_;
+    to->slots_[index].data.store(from.slots_[index].data.load());
+  }
+};
+
+namespace {
+
+constexpr int kSizeBits = 10;
+constexpr uint64_t kKey = 0x123456789abcdef0;
+// A key for the same slot as kKey.
+constexpr uint64_t kOtherKey = kKey ^ (uint64_t{0x5a} << 40);
+
+TEST(TranspositionTableTest, StoreAndProbe) {
+  TranspositionTable tt(kSizeBits);
+  TTEntry entry;
+  EXPECT_FALSE(tt.Probe(kKey, &entry));
+
+  tt.Store(kKey, /*depth=*/7, /*score=*/-99998, Bound::kLower, /*move=*/127);
+  ASSERT_TRUE(tt.Probe(kKey, &entry));
+  EXPECT_EQ(entry.key, kKey);
+  EXPECT_EQ(entry.depth, 7);
+  EXPECT_EQ(entry.score, -99998);
+  EXPECT_EQ(entry.bound, Bound::kLower);
+  EXPECT_EQ(entry.move, 127);
+  EXPECT_FALSE(tt.Probe(kOtherKey, &entry));
+}
+
+TEST(TranspositionTableTest, StoresEntryWithoutMove) {
+  TranspositionTable tt(kSizeBits);
+  tt.Store(kKey, /*depth=*/0, /*score=*/0, Bound::kUpper, /*move=*/-1);
+  TTEntry entry;
+  ASSERT_TRUE(tt.Probe(kKey, &entry));
+  EXPECT_EQ(entry.depth, 0);
+  EXPECT_EQ(entry.score, 0);
+  EXPECT_EQ(entry.bound, Bound::kUpper);
+  EXPECT_EQ(entry.move, -1);
+}
+
+TEST(TranspositionTableTest, NewEntryReplacesOld) {
+  TranspositionTable tt(kSizeBits);
+  tt.Store(kKey, /*depth=*/9, /*score=*/5, Bound::kExact, /*move=*/3);
+  tt.Store(kOtherKey, /*depth=*/1, /*score=*/6, Bound::kExact, /*move=*/4);
+  TTEntry entry;
+  EXPECT_FALSE(tt.Probe(kKey, &entry));
+  ASSERT_TRUE(tt.Probe(kOtherKey, &entry));
+  EXPECT_EQ(entry.score, 6);
+
+  tt.Clear();
+  EXPECT_FALSE(tt.Probe(kOtherKey, &entry));
+}
+
+TEST(TranspositionTableTest, TornSlotIsAMiss) {
+  TranspositionTable tt(kSizeBits);
+  tt.Store(kKey, /*depth=*/4, /*score=*/100, Bound::kExact, /*move=*/10);
+  TranspositionTable other(kSizeBits);
+  other.Store(kOtherKey, /*depth=*/5, /*score=*/-100, Bound::kLower,
+              /*move=*/20);
+
+  // The key check of the first entry with the data of the second matches
+  // neither key.
+  TranspositionTablePeer::TearSlot(kKey, other, &tt);
+  TTEntry entry;
+  EXPECT_FALSE(tt.Probe(kKey, &entry));
+  EXPECT_FALSE(tt.Probe(kOtherKey, &entry));
+}
+
+}  // namespace
+}  // namespace santorini
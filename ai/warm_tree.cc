@@ -0,0 +1,96 @@
+#include "ai/warm_tree.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "absl/log/log.h"
+#include "ai/mcts.h"
+#include "game/board.h"
+#include "game/packed_board.h"
+
+namespace santorini {
+namespace {
+
+// Copies `node` and its subtree. Children of nodes with fewer than
+// `min_visits` visits are dropped, turning those nodes back into leaves. The
+// approximate memory used by the copy is added to `bytes`.
+std::shared_ptr<Node> CopyTree(const Node& node, Node* parent, int min_visits,
+                               int64_t* bytes) {
+  auto copy = std::make_shared<Node>(node);
+  copy->parent = parent;
+  // Release the copied children along with their memory.
+  std::vector<std::shared_ptr<Node>>().swap(copy->children);
+  if (node.visits < min_visits) {
+    copy->expanded = false;
+    copy->unexpanded_moves.clear();
+    copy->unexpanded_moves.shrink_to_fit();
+  } else {
+    copy->children.reserve(node.children.size());
+    for (const std::shared_ptr<Node>& child : node.children) {
+      copy->children.push_back(
+          CopyTree(*child, copy.get(), min_visits, bytes));
+    }
+  }
+  // Nodes are allocated along with their shared_ptr control block.
+  *bytes += sizeof(Node) + 16 +
+            copy->children.capacity() * sizeof(std::shared_ptr<Node>) +
+            copy->unexpanded_moves.capacity() * sizeof(Board::Move);
+  return copy;
+}
+
+}  // namespace
+
+WarmTree::WarmTree(const WarmTreeOptions& options) : options_(options) {}
+
+std::shared_ptr<Node> WarmTree::Checkout(const Board& board,
+                                         int visits) const {
+  std::shared_ptr<const Node> tree;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = trees_.find(PackedBoard(board));
+    if (it == trees_.end() || it->second.tree->visits <= visits) {
+      return nullptr;
+    }
+    tree = it->second.tree;
+  }
+  // Stored trees are never modified, so they can be copied without the lock.
+  int64_t bytes = 0;
+  return CopyTree(*tree, nullptr, /*min_visits=*/0, &bytes);
+}
+
+void WarmTree::Commit(const Board& board, const Node& tree) {
+  if (static_cast<int>(board.past_moves().size()) >= options_.max_plies ||
+      tree.visits < options_.min_visits) {
+    return;
+  }
+  // With games played in parallel, another game may have committed a bigger
+  // search of the position meanwhile, which is kept. Check before copying,
+  // and again once the copy is made.
+  const PackedBoard position(board);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = trees_.find(position);
+    if (it != trees_.end() && it->second.tree->visits >= tree.visits) return;
+  }
+  Entry entry;
+  entry.tree = CopyTree(tree, nullptr, options_.min_visits, &entry.bytes);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& stored = trees_[position];
+  if (stored.tree != nullptr && stored.tree->visits >= tree.visits) return;
+  if (bytes_ - stored.bytes + entry.bytes > options_.max_bytes) {
+    VLOG(1) << "warm tree is full at " << bytes_ << " bytes";
+    if (stored.tree == nullptr) trees_.erase(position);
+    return;
+  }
+  bytes_ += entry.bytes - stored.bytes;
+  stored = std::move(entry);
+}
+
+int64_t WarmTree::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+}  // namespace santorini
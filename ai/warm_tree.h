@@ -0,0 +1,65 @@
+#ifndef SANTORINI_AI_WARM_TREE_H_
+#define SANTORINI_AI_WARM_TREE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "absl/container/flat_hash_map.h"
+#include "ai/mcts.h"
+#include "game/board.h"
+#include "game/packed_board.h"
+
+namespace santorini {
+
+struct WarmTreeOptions {
+  // Only positions with fewer than this many moves played are kept.
+  int max_plies = 8;
+
+  // Nodes with fewer visits are kept without their children.
+  int min_visits = 1000;
+
+  // Trees are no longer added once the cache holds about this much memory.
+  int64_t max_bytes = int64_t{1} << 30;
+};
+
+// A cache of MCTS trees for early positions, shared by the MctsAI players of
+// one process so that each game can start from the statistics gathered in
+// earlier games rather than from an empty root.
+//
+// Players check out a private copy of the tree for a position before
+// searching it, and commit the searched tree back when done, replacing the
+// old one unless that has at least as many visits. Stored trees are pruned
+// copies, so a cached position costs a small fraction of the memory of a
+// full search tree. All methods are thread-safe.
+class WarmTree {
+ public:
+  explicit WarmTree(const WarmTreeOptions& options = {});
+
+  // Returns a copy of the tree for `board` if it has more than `visits`
+  // visits, otherwise null. Only a tree that is returned is copied.
+  std::shared_ptr<Node> Checkout(const Board& board, int visits) const;
+
+  // Stores a pruned copy of `tree`, the search tree for `board`, if `board`
+  // is early enough in the game, there is room, and the stored tree for
+  // `board`, if any, has fewer visits.
+  void Commit(const Board& board, const Node& tree);
+
+  // The approximate memory held by the cached trees.
+  int64_t bytes() const;
+
+ private:
+  struct Entry {
+    std::shared_ptr<const Node> tree;
+    int64_t bytes = 0;
+  };
+
+  WarmTreeOptions options_;
+  mutable std::mutex mutex_;
+  absl::flat_hash_map<PackedBoard, Entry> trees_;
+  int64_t bytes_ = 0;
+};
+
+}  // namespace santorini
+
+#endif
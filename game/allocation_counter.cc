@@ -0,0 +1,70 @@
+#include "game/allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace santorini {
+namespace {
+
+std::atomic<int64_t> num_allocations{0};
+std::atomic<int64_t> num_bytes{0};
+
+void* CountedAlloc(size_t size, size_t alignment) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  num_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (size == 0) size = 1;
+  if (alignment <= alignof(std::max_align_t)) return std::malloc(size);
+  // aligned_alloc wants a multiple of the alignment.
+  return std::aligned_alloc(alignment,
+                            (size + alignment - 1) / alignment * alignment);
+}
+
+void* CountedNew(size_t size, size_t alignment) {
+  void* ptr = CountedAlloc(size, alignment);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+}  // namespace
+
+AllocationCounts GetAllocationCounts() {
+  return {.allocations = num_allocations.load(std::memory_order_relaxed),
+          .bytes = num_bytes.load(std::memory_order_relaxed)};
+}
+
+}  // namespace santorini
+
+void* operator new(size_t size) {
+  return santorini::CountedNew(size, alignof(std::max_align_t));
+}
+void* operator new[](size_t size) {
+  return santorini::CountedNew(size, alignof(std::max_align_t));
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+  return santorini::CountedNew(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return santorini::CountedNew(size, static_cast<size_t>(alignment));
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return santorini::CountedAlloc(size, alignof(std::max_align_t));
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return santorini::CountedAlloc(size, alignof(std::max_align_t));
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
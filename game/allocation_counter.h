@@ -0,0 +1,50 @@
+#ifndef SANTORINI_GAME_ALLOCATION_COUNTER_H_
+#define SANTORINI_GAME_ALLOCATION_COUNTER_H_
+
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+
+namespace santorini {
+
+// Counts the heap allocations made through operator new, by all threads,
+// for benchmarks to report what the code they measure allocates. Linking
+// this library replaces the global operator new and delete with versions
+// that count into relaxed atomics before calling malloc and free, so only
+// link it into benchmarks.
+struct AllocationCounts {
+  int64_t allocations = 0;
+  int64_t bytes = 0;
+};
+
+// The allocations made by the process so far.
+AllocationCounts GetAllocationCounts();
+
+// Counts the allocations made from construction on.
+class AllocationCounter {
+ public:
+  AllocationCounter() : start_(GetAllocationCounts()) {}
+
+  AllocationCounts counts() const {
+    const AllocationCounts now = GetAllocationCounts();
+    return {.allocations = now.allocations - start_.allocations,
+            .bytes = now.bytes - start_.bytes};
+  }
+
+  // Sets the "allocs" and "bytes_alloc" counters of `state` to the
+  // allocations per benchmark iteration so far.
+  void SetCounters(benchmark::State& state) const {
+    const AllocationCounts allocated = counts();
+    state.counters["allocs"] = benchmark::Counter(
+        allocated.allocations, benchmark::Counter::kAvgIterations);
+    state.counters["bytes_alloc"] = benchmark::Counter(
+        allocated.bytes, benchmark::Counter::kAvgIterations);
+  }
+
+ private:
+  const AllocationCounts start_;
+};
+
+}  // namespace santorini
+
+#endif
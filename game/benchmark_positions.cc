@@ -0,0 +1,74 @@
+#include "game/benchmark_positions.h"
+
+#include <fstream>
+
+#include "absl/log/check.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/string_view.h"
+
+namespace santorini {
+
+GamePhase PhaseOf(const Board& board) {
+  int blocks = 0;
+  for (int row = 0; row < Board::kNumRows; ++row) {
+    for (int col = 0; col < Board::kNumCols; ++col) {
+      blocks += board.height(row, col);
+    }
+  }
+  if (blocks < 12) return GamePhase::kOpening;
+  if (blocks <= 24) return GamePhase::kMidgame;
+  return GamePhase::kEndgame;
+}
+
+const char* GamePhaseName(GamePhase phase) {
+  switch (phase) {
+    case GamePhase::kOpening:
+      return "opening";
+    case GamePhase::kMidgame:
+      return "midgame";
+    case GamePhase::kEndgame:
+      return "endgame";
+  }
+  return "";
+}
+
+std::vector<Board> ReadPositions(const std::string& path) {
+  std::ifstream file(path);
+  CHECK(file) << "Can't read " << path;
+  std::vector<Board> positions;
+  std::string line;
+  while (std::getline(file, line)) {
+    const absl::string_view notation = absl::StripAsciiWhitespace(line);
+    if (notation.empty() || notation[0] == '#') continue;
+    Board& board = positions.emplace_back();
+    CHECK(Board::ParseNotation(notation, &board))
+        << path << ": invalid position " << notation;
+  }
+  return positions;
+}
+
+const std::vector<Board>& BenchmarkPositions() {
+  static const std::vector<Board>* const positions =
+      new std::vector<Board>(ReadPositions("game/testdata/positions.txt"));
+  return *positions;
+}
+
+std::vector<Board> BenchmarkPositions(GamePhase phase) {
+  std::vector<Board> positions;
+  for (const Board& board : BenchmarkPositions()) {
+    if (PhaseOf(board) == phase) positions.push_back(board);
+  }
+  return positions;
+}
+
+std::vector<Board> BenchmarkPositions(GamePhase phase, int count) {
+  const std::vector<Board> all = BenchmarkPositions(phase);
+  if (static_cast<int>(all.size()) <= count) return all;
+  std::vector<Board> positions;
+  for (int i = 0; i < count; ++i) {
+    positions.push_back(all[i * all.size() / count]);
+  }
+  return positions;
+}
+
+}  // namespace santorini
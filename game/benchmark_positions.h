@@ -0,0 +1,41 @@
+#ifndef SANTORINI_GAME_BENCHMARK_POSITIONS_H_
+#define SANTORINI_GAME_BENCHMARK_POSITIONS_H_
+
+#include <string>
+#include <vector>
+
+#include "game/board.h"
+
+namespace santorini {
+
+// Where a position is in the game, by the number of blocks built, which is
+// the number of moves made: the opening is the first 12 moves, the
+// middlegame up to move 24, and the endgame the rest.
+enum class GamePhase { kOpening, kMidgame, kEndgame };
+constexpr int kNumGamePhases = 3;
+
+GamePhase PhaseOf(const Board& board);
+const char* GamePhaseName(GamePhase phase);
+
+// Reads positions in notation, see Board::ToNotation, one per line. Blank
+// lines and lines starting with '#' are skipped. CHECK-fails if the file
+// can't be read or a position is invalid.
+std::vector<Board> ReadPositions(const std::string& path);
+
+// The benchmark corpus, testdata/positions.txt: a few hundred unfinished
+// positions from self-play, about a third in each phase. Benchmarks should
+// measure on these rather than on the start position alone, which is
+// unlike the positions that searches spend their time on. Read from the
+// working directory, which is the runfiles root under bazel run and test.
+const std::vector<Board>& BenchmarkPositions();
+
+// The positions of the corpus in `phase`.
+std::vector<Board> BenchmarkPositions(GamePhase phase);
+
+// At most `count` positions of the corpus in `phase`, spread evenly over it,
+// for benchmarks too slow to run on all of them.
+std::vector<Board> BenchmarkPositions(GamePhase phase, int count);
+
+}  // namespace santorini
+
+#endif
@@ -15,6 +15,54 @@ constexpr int kMoveMap[8][2] = {
     {-1, -1}, {-1, 0}, {-1, +1}, {0, -1}, {0, +1}, {+1, -1}, {+1, 0}, {+1, +1},
 };
 
+constexpr int kNumSquares = Board::kNumRows * Board::kNumCols;
+
+// Random keys for Zobrist hashing, generated at compile time with
+// splitmix64.
+struct ZobristKeys {
+  // Indexed by (square, height). Height 0 has no key.
+  uint64_t height[kNumSquares][5];
+  // Indexed by (player, worker, square).
+  uint64_t worker[2][2][kNumSquares];
+  // Xor-ed in when player 1 is to move.
+  uint64_t player;
+};
+
+constexpr ZobristKeys MakeZobristKeys() {
+  ZobristKeys keys{};
+  uint64_t state = 0x5eed5a7704141ULL;
+  auto next = [&state]() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  };
+  for (int square = 0; square < kNumSquares; ++square) {
+    for (int height = 1; height < 5; ++height) {
+      keys.height[square][height] = next();
+    }
+  }
+  for (int player = 0; player < 2; ++player) {
+    for (int worker = 0; worker < 2; ++worker) {
+      for (int square = 0; square < kNumSquares; ++square) {
+        keys.worker[player][worker][square] = next();
+      }
+    }
+  }
+  keys.player = next();
+  return keys;
+}
+
+constexpr ZobristKeys kZobrist = MakeZobristKeys();
+
+uint64_t WorkerKey(int player, int worker, int row, int col) {
+  return kZobrist.worker[player][worker][row * Board::kNumCols + col];
+}
+
+uint64_t HeightKey(int row, int col, int height) {
+  return kZobrist.height[row * Board::kNumCols + col][height];
+}
+
 }  // namespace
 
 std::string MoveDebugString(int move_id) {
@@ -36,26 +84,125 @@ Board::Board()
     for (int worker : {0, 1}) {
       worker_map_[workers_[player][worker][0]][workers_[player][worker][1]] =
           true;
+      hash_ ^= WorkerKey(player, worker, workers_[player][worker][0],
+                         workers_[player][worker][1]);
+    }
+  }
+}
+
+Board::Board(const int heights[kNumRows][kNumCols], const int workers[2][2][2],
+             int current_player)
+    : current_player_(current_player) {
+  CHECK(current_player == 0 || current_player == 1);
+  std::memset(worker_map_, 0, kNumRows * kNumCols * sizeof(bool));
+  for (int row = 0; row < kNumRows; ++row) {
+    for (int col = 0; col < kNumCols; ++col) {
+      CHECK(heights[row][col] >= 0 && heights[row][col] <= 4);
+      heights_[row][col] = heights[row][col];
+      hash_ ^= HeightKey(row, col, heights_[row][col]);
+    }
+  }
+  for (int player : {0, 1}) {
+    for (int worker : {0, 1}) {
+      const int row = workers[player][worker][0];
+      const int col = workers[player][worker][1];
+      CHECK(row >= 0 && row < kNumRows && col >= 0 && col < kNumCols);
+      CHECK(!worker_map_[row][col]) << "Two workers on " << row << "," << col;
+      CHECK_LT(heights_[row][col], 4) << "Worker on a dome";
+      worker_map_[row][col] = true;
+      workers_[player][worker][0] = row;
+      workers_[player][worker][1] = col;
+      hash_ ^= WorkerKey(player, worker, row, col);
+      if (heights_[row][col] == 3) winner_ = player;
+    }
+  }
+  if (current_player_ == 1) hash_ ^= kZobrist.player;
+}
+
+Board::Board(absl::string_view notation) {
+  CHECK(ParseNotation(notation, this)) << "Invalid position: " << notation;
+}
+
+bool Board::ParseNotation(absl::string_view notation, Board* board) {
+  int heights[kNumRows][kNumCols];
+  int workers[2][2][2];
+  bool seen[2][2] = {};
+  int row = 0;
+  int col = -1;
+  size_t i = 0;
+  for (; i < notation.size() && notation[i] != ' '; ++i) {
+    const char c = notation[i];
+    if (c == '/') {
+      if (col != kNumCols - 1 || ++row == kNumRows) return false;
+      col = -1;
+    } else if (c >= '0' && c <= '4') {
+      if (++col == kNumCols) return false;
+      heights[row][col] = c - '0';
+    } else if (c == 'A' || c == 'a' || c == 'B' || c == 'b') {
+      const int player = (c == 'B' || c == 'b') ? 1 : 0;
+      const int worker = (c == 'a' || c == 'b') ? 1 : 0;
+      // A worker follows the height of its square, and stands below a dome.
+      if (col < 0 || seen[player][worker] || heights[row][col] == 4 ||
+          (i > 0 && notation[i - 1] > '4')) {
+        return false;
+      }
+      seen[player][worker] = true;
+      workers[player][worker][0] = row;
+      workers[player][worker][1] = col;
+    } else {
+      return false;
+    }
+  }
+  if (row != kNumRows - 1 || col != kNumCols - 1) return false;
+  if (!seen[0][0] || !seen[0][1] || !seen[1][0] || !seen[1][1]) return false;
+  if (notation.substr(i) != " 0" && notation.substr(i) != " 1") return false;
+  *board = Board(heights, workers, notation[i + 1] - '0');
+  return true;
+}
+
+std::string Board::ToNotation() const {
+  std::string notation;
+  notation.reserve(40);
+  for (int row = 0; row < kNumRows; ++row) {
+    if (row > 0) notation.push_back('/');
+    for (int col = 0; col < kNumCols; ++col) {
+      notation.push_back('0' + heights_[row][col]);
+      for (int player : {0, 1}) {
+        for (int worker : {0, 1}) {
+          if (workers_[player][worker][0] == row &&
+              workers_[player][worker][1] == col) {
+            notation.push_back("AaBb"[2 * player + worker]);
+          }
+        }
+      }
     }
   }
+  notation.push_back(' ');
+  notation.push_back('0' + current_player_);
+  return notation;
 }
 
 std::vector<Board::Move> Board::PossibleMoves() const {
   std::vector<Move> moves;
-  moves.reserve(128);
+  PossibleMoves(&moves);
+  return moves;
+}
+
+void Board::PossibleMoves(std::vector<Move>* moves) const {
+  moves->clear();
+  moves->reserve(128);
   int move_idx = 0;
   for (int worker : {0, 1}) {
     for (int move = 0; move < 8; ++move) {
       for (int build = 0; build < 8; ++build) {
         Move m{.move_id = move_idx};
         if (ValidMove(worker, move, build, &m.is_winning)) {
-          moves.push_back(m);
+          moves->push_back(m);
         }
         ++move_idx;
       }
     }
   }
-  return moves;
 }
 
 std::vector<bool> Board::PossibleMoveMask() const {
@@ -73,6 +220,21 @@ std::vector<bool> Board::PossibleMoveMask() const {
   return moves;
 }
 
+Board::MoveSquares Board::DecodeMove(int move_id) const {
+  const int worker = move_id >> 6;
+  const int move = (move_id >> 3) & 0x7;
+  const int build = move_id & 0x7;
+  MoveSquares squares;
+  squares.worker = worker;
+  squares.from_row = workers_[current_player_][worker][0];
+  squares.from_col = workers_[current_player_][worker][1];
+  squares.to_row = squares.from_row + kMoveMap[move][0];
+  squares.to_col = squares.from_col + kMoveMap[move][1];
+  squares.build_row = squares.to_row + kMoveMap[build][0];
+  squares.build_col = squares.to_col + kMoveMap[build][1];
+  return squares;
+}
+
 bool Board::MakeMove(int move_id) {
   const int worker = move_id >> 6;
   const int move = (move_id >> 3) & 0x7;
@@ -95,19 +257,58 @@ bool Board::MakeMove(int move_id) {
 
   workers_[current_player_][worker][0] = new_worker_row;
   workers_[current_player_][worker][1] = new_worker_col;
+  hash_ ^= WorkerKey(current_player_, worker, worker_row, worker_col) ^
+           WorkerKey(current_player_, worker, new_worker_row, new_worker_col);
 
   CHECK(heights_[build_row][build_col] < 4);
+  hash_ ^= HeightKey(build_row, build_col, heights_[build_row][build_col]);
   heights_[build_row][build_col]++;
+  hash_ ^= HeightKey(build_row, build_col, heights_[build_row][build_col]);
 
   if (heights_[new_worker_row][new_worker_col] == 3) {
     winner_ = current_player_;
   }
 
   current_player_ = (current_player_ + 1) % 2;
+  hash_ ^= kZobrist.player;
 
   return true;
 }
 
+void Board::UnmakeMove() {
+  CHECK(!past_moves_.empty());
+  const int move_id = past_moves_.back();
+  past_moves_.pop_back();
+
+  const int worker = move_id >> 6;
+  const int move = (move_id >> 3) & 0x7;
+  const int build = move_id & 0x7;
+
+  current_player_ = (current_player_ + 1) % 2;
+  hash_ ^= kZobrist.player;
+  // The game ends with a winning move, so no earlier position has a winner.
+  winner_ = -1;
+
+  const int new_worker_row = workers_[current_player_][worker][0];
+  const int worker_row = new_worker_row - kMoveMap[move][0];
+  const int build_row = new_worker_row + kMoveMap[build][0];
+  const int new_worker_col = workers_[current_player_][worker][1];
+  const int worker_col = new_worker_col - kMoveMap[move][1];
+  const int build_col = new_worker_col + kMoveMap[build][1];
+
+  CHECK(heights_[build_row][build_col] > 0);
+  hash_ ^= HeightKey(build_row, build_col, heights_[build_row][build_col]);
+  heights_[build_row][build_col]--;
+  hash_ ^= HeightKey(build_row, build_col, heights_[build_row][build_col]);
+
+  worker_map_[new_worker_row][new_worker_col] = false;
+  worker_map_[worker_row][worker_col] = true;
+  workers_[current_player_][worker][0] = worker_row;
+  workers_[current_player_][worker][1] = worker_col;
+  hash_ ^= WorkerKey(current_player_, worker, worker_row, worker_col) ^
+           WorkerKey(current_player_, worker, new_worker_row, new_worker_col);
+}
+
 bool Board::ValidMove(int worker, int move, int build, bool* is_winning) const {
   const int worker_row = workers_[current_player_][worker][0];
   const int new_worker_row = worker_row + kMoveMap[move][0];
@@ -1,9 +1,12 @@
 #ifndef SANTORINI_GAME_BOARD_H_
 #define SANTORINI_GAME_BOARD_H_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include "absl/strings/string_view.h"
+
 namespace santorini {
 
 std::string MoveDebugString(int move_id);
@@ -23,6 +26,28 @@ class Board {
 
   Board();
 
+  // Sets up an arbitrary position with no move history: heights by row and
+  // column, worker squares by player, worker and row/column, and the player
+  // to move. If a worker stands on level 3, its player has won.
+  Board(const int heights[kNumRows][kNumCols], const int workers[2][2][2],
+        int current_player);
+
+  // Sets up the position given in notation, see ToNotation. The notation
+  // must be valid; use ParseNotation for untrusted input.
+  explicit Board(absl::string_view notation);
+
+  // Parses a position in notation into `board`. Returns false, leaving
+  // `board` unchanged, if the notation is not valid.
+  static bool ParseNotation(absl::string_view notation, Board* board);
+
+  // Returns the position, without its move history, in notation: the rows
+  // from the top separated by '/', each square as its height, followed by a
+  // letter if a worker stands on it, then a space and the player to move.
+  // The letters are 'A' and 'a' for workers 0 and 1 of player 0, and 'B'
+  // and 'b' for those of player 1. The start position is
+  //   00000/00A00a0/00000/00B00b0/00000 0
+  std::string ToNotation() const;
+
   // Move a worker and build. Returns true if the move was valid.
   // An invalid move will not change the state of the board.
   //
@@ -41,6 +66,9 @@ class Board {
   // Note that "build" is relative to the location after "move" is applied.
   bool MakeMove(int move_id);
 
+  // Undo the last move made with MakeMove. There must be a past move.
+  void UnmakeMove();
+
   // Returns a vector of possible moves.
   struct Move {
     int move_id;
@@ -48,10 +76,23 @@ class Board {
   };
   std::vector<Move> PossibleMoves() const;
 
+  // Same as above, but fills `moves` to avoid allocating in tight loops.
+  void PossibleMoves(std::vector<Move>* moves) const;
+
   // Returns a vector of 128 booleans, representing which of the 128
   // possible moves in any given turn are valid.
   std::vector<bool> PossibleMoveMask() const;
 
+  // The squares touched by a move of the current player. The move is not
+  // checked for validity.
+  struct MoveSquares {
+    int worker;
+    int from_row, from_col;
+    int to_row, to_col;
+    int build_row, build_col;
+  };
+  MoveSquares DecodeMove(int move_id) const;
+
   // Print a colored view of the board to the console.
   void Print() const;
 
@@ -61,9 +102,14 @@ class Board {
 
   int current_player() const { return current_player_; }
 
+  // A Zobrist hash of the position: heights, workers and the player to move.
+  // The move history is not included.
+  uint64_t hash() const { return hash_; }
+
   const std::vector<int> past_moves() const { return past_moves_; }
 
   int height(int row, int col) const { return heights_[row][col]; }
+  bool occupied(int row, int col) const { return worker_map_[row][col]; }
   const int* worker(int player, int worker) const {
     return workers_[player][worker];
   }
@@ -77,6 +123,7 @@ class Board {
   bool worker_map_[kNumRows][kNumCols];
   int workers_[2][2][2];  // (player, worker, row/column)
   int winner_ = -1;
+  uint64_t hash_ = 0;
 };
 
 }  // namespace santorini
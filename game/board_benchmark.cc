@@ -0,0 +1,155 @@
+// Microbenchmarks of the Board primitives that searches are built on, so
+// that a change in end-to-end speed can be traced to the layer that moved.
+//
+// To run the benchmark:
+//   $ bazel run -c opt game:board_benchmark
+//
+// Unless noted otherwise, the argument is the game phase of the corpus
+// positions measured on, see game/benchmark_positions.h, and each benchmark
+// iteration goes over all positions of that phase. Besides the rates, the
+// reported counters are the heap allocations and bytes allocated per
+// iteration (allocs, bytes_alloc).
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "game/allocation_counter.h"
+#include "game/benchmark_positions.h"
+#include "game/board.h"
+
+namespace santorini {
+namespace {
+
+GamePhase Phase(const benchmark::State& state) {
+  return static_cast<GamePhase>(state.range(0));
+}
+
+// Generates the moves of each position into a new vector.
+static void BM_PossibleMoves(benchmark::State& state) {
+  const std::vector<Board> boards = BenchmarkPositions(Phase(state));
+  const AllocationCounter allocations;
+  int64_t moves = 0;
+  for (auto _ : state) {
+    for (const Board& board : boards) {
+      const std::vector<Board::Move> possible_moves = board.PossibleMoves();
+      moves += possible_moves.size();
+      benchmark::DoNotOptimize(possible_moves.data());
+    }
+  }
+  state.counters["moves/s"] =
+      benchmark::Counter(moves, benchmark::Counter::kIsRate);
+  allocations.SetCounters(state);
+  state.SetLabel(GamePhaseName(Phase(state)));
+}
+BENCHMARK(BM_PossibleMoves)->DenseRange(0, kNumGamePhases - 1);
+
+// As above, into a vector reused across calls.
+static void BM_PossibleMovesReused(benchmark::State& state) {
+  const std::vector<Board> boards = BenchmarkPositions(Phase(state));
+  std::vector<Board::Move> possible_moves;
+  possible_moves.reserve(128);
+  const AllocationCounter allocations;
+  int64_t moves = 0;
+  for (auto _ : state) {
+    for (const Board& board : boards) {
+      board.PossibleMoves(&possible_moves);
+      moves += possible_moves.size();
+      benchmark::DoNotOptimize(possible_moves.data());
+    }
+  }
+  state.counters["moves/s"] =
+      benchmark::Counter(moves, benchmark::Counter::kIsRate);
+  allocations.SetCounters(state);
+  state.SetLabel(GamePhaseName(Phase(state)));
+}
+BENCHMARK(BM_PossibleMovesReused)->DenseRange(0, kNumGamePhases - 1);
+
+static void BM_PossibleMoveMask(benchmark::State& state) {
+  const std::vector<Board> boards = BenchmarkPositions(Phase(state));
+  const AllocationCounter allocations;
+  for (auto _ : state) {
+    for (const Board& board : boards) {
+      const std::vector<bool> mask = board.PossibleMoveMask();
+      benchmark::DoNotOptimize(mask.size());
+    }
+  }
+  state.counters["positions/s"] = benchmark::Counter(
+      state.iterations() * boards.size(), benchmark::Counter::kIsRate);
+  allocations.SetCounters(state);
+  state.SetLabel(GamePhaseName(Phase(state)));
+}
+BENCHMARK(BM_PossibleMoveMask)->DenseRange(0, kNumGamePhases - 1);
+
+// Makes and unmakes every legal move of each position.
+static void BM_MakeUnmakeMove(benchmark::State& state) {
+  std::vector<Board> boards = BenchmarkPositions(Phase(state));
+  std::vector<std::vector<Board::Move>> possible_moves;
+  int64_t moves_per_iteration = 0;
+  for (const Board& board : boards) {
+    possible_moves.push_back(board.PossibleMoves());
+    moves_per_iteration += possible_moves.back().size();
+  }
+  const AllocationCounter allocations;
+  for (auto _ : state) {
+    for (size_t i = 0; i < boards.size(); ++i) {
+      for (const Board::Move& move : possible_moves[i]) {
+        boards[i].MakeMove(move.move_id);
+        boards[i].UnmakeMove();
+      }
+    }
+  }
+  state.counters["moves/s"] = benchmark::Counter(
+      state.iterations() * moves_per_iteration, benchmark::Counter::kIsRate);
+  allocations.SetCounters(state);
+  state.SetLabel(GamePhaseName(Phase(state)));
+}
+BENCHMARK(BM_MakeUnmakeMove)->DenseRange(0, kNumGamePhases - 1);
+
+// Tries all 128 move ids on each position, as a caller validating moves
+// would, unmaking the valid ones. Most ids are invalid, so this mostly
+// measures move validation.
+static void BM_MakeMoveAllIds(benchmark::State& state) {
+  std::vector<Board> boards = BenchmarkPositions(Phase(state));
+  const AllocationCounter allocations;
+  int64_t valid = 0;
+  for (auto _ : state) {
+    for (Board& board : boards) {
+      for (int move_id = 0; move_id < 128; ++move_id) {
+        if (board.MakeMove(move_id)) {
+          ++valid;
+          board.UnmakeMove();
+        }
+      }
+    }
+  }
+  state.counters["ids/s"] = benchmark::Counter(
+      state.iterations() * boards.size() * 128, benchmark::Counter::kIsRate);
+  state.counters["valid"] = benchmark::Counter(
+      valid, benchmark::Counter::kAvgIterations);
+  allocations.SetCounters(state);
+  state.SetLabel(GamePhaseName(Phase(state)));
+}
+BENCHMARK(BM_MakeMoveAllIds)->DenseRange(0, kNumGamePhases - 1);
+
+// Copies a board with the argument's number of moves of history, as MCTS
+// does for every iteration.
+static void BM_BoardCopy(benchmark::State& state) {
+  Board board;
+  for (int i = 0; i < state.range(0); ++i) {
+    const std::vector<Board::Move> moves = board.PossibleMoves();
+    board.MakeMove(moves[(i * 37) % moves.size()].move_id);
+  }
+  const AllocationCounter allocations;
+  for (auto _ : state) {
+    Board copy = board;
+    benchmark::DoNotOptimize(copy);
+  }
+  state.counters["sizeof"] = sizeof(Board);
+  allocations.SetCounters(state);
+}
+BENCHMARK(BM_BoardCopy)->Arg(0)->Arg(16)->Arg(32);
+
+}  // namespace
+}  // namespace santorini
+
+BENCHMARK_MAIN();
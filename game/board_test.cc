@@ -103,6 +103,106 @@ TEST(BoardTest, PossibleMoveMask_MadeMoves) {
   }
 }
 
+TEST(BoardTest, UnmakeMove_RestoresPosition) {
+  Board board;
+  const uint64_t start_hash = board.hash();
+  const std::vector<bool> start_moves = board.PossibleMoveMask();
+
+  ASSERT_TRUE(board.MakeMove(Id(0, 0, 4)));
+  const uint64_t hash_after_one = board.hash();
+  const std::vector<bool> moves_after_one = board.PossibleMoveMask();
+  ASSERT_TRUE(board.MakeMove(Id(0, 5, 4)));
+  EXPECT_NE(board.hash(), hash_after_one);
+
+  board.UnmakeMove();
+  EXPECT_EQ(board.current_player(), 1);
+  EXPECT_EQ(board.hash(), hash_after_one);
+  EXPECT_EQ(board.PossibleMoveMask(), moves_after_one);
+  EXPECT_EQ(board.height(4, 1), 0);
+  EXPECT_EQ(board.worker(1, 0)[0], 3);
+  EXPECT_EQ(board.worker(1, 0)[1], 1);
+
+  board.UnmakeMove();
+  EXPECT_EQ(board.current_player(), 0);
+  EXPECT_EQ(board.hash(), start_hash);
+  EXPECT_EQ(board.PossibleMoveMask(), start_moves);
+  EXPECT_TRUE(board.past_moves().empty());
+}
+
+TEST(BoardTest, Hash_SamePositionFromDifferentOrders) {
+  // Each player moves both workers to the edge and builds in the corner,
+  // in a different order.
+  Board a;
+  ASSERT_TRUE(a.MakeMove(Id(0, 1, 3)));
+  ASSERT_TRUE(a.MakeMove(Id(0, 6, 3)));
+  ASSERT_TRUE(a.MakeMove(Id(1, 1, 4)));
+  ASSERT_TRUE(a.MakeMove(Id(1, 6, 4)));
+
+  Board b;
+  ASSERT_TRUE(b.MakeMove(Id(1, 1, 4)));
+  ASSERT_TRUE(b.MakeMove(Id(1, 6, 4)));
+  ASSERT_TRUE(b.MakeMove(Id(0, 1, 3)));
+  ASSERT_TRUE(b.MakeMove(Id(0, 6, 3)));
+
+  EXPECT_EQ(a.hash(), b.hash());
+  EXPECT_NE(a.hash(), Board().hash());
+}
+
+TEST(BoardTest, Notation_Start) {
+  EXPECT_EQ(Board().ToNotation(), "00000/00A00a0/00000/00B00b0/00000 0");
+  const Board board("00000/00A00a0/00000/00B00b0/00000 0");
+  EXPECT_EQ(board.hash(), Board().hash());
+  EXPECT_EQ(board.PossibleMoveMask(), Board().PossibleMoveMask());
+}
+
+TEST(BoardTest, Notation_RoundTripsPlayedPositions) {
+  Board board;
+  for (int i = 0; i < 30 && board.winner() == -1; ++i) {
+    const std::vector<Board::Move> moves = board.PossibleMoves();
+    if (moves.empty()) break;
+    board.MakeMove(moves[(i * 37) % moves.size()].move_id);
+
+    const std::string notation = board.ToNotation();
+    Board parsed;
+    ASSERT_TRUE(Board::ParseNotation(notation, &parsed)) << notation;
+    EXPECT_EQ(parsed.ToNotation(), notation);
+    EXPECT_EQ(parsed.hash(), board.hash()) << notation;
+    EXPECT_EQ(parsed.PossibleMoveMask(), board.PossibleMoveMask())
+        << notation;
+    EXPECT_EQ(parsed.winner(), board.winner()) << notation;
+  }
+}
+
+TEST(BoardTest, Notation_WorkerOnLevelThreeHasWon) {
+  const Board board("00000/00A03a0/00000/00B00b0/00000 1");
+  EXPECT_EQ(board.winner(), 0);
+}
+
+TEST(BoardTest, Notation_RejectsInvalid) {
+  for (const char* notation : {
+           "",
+           "00000/00A00a0/00000/00B00b0/00000",
+           "00000/00A00a0/00000/00B00b0/00000 2",
+           "00000/00A00a0/00000/00B00b0/00000 0 ",
+           "00000/00A00a0/00000/00B00b0 0",
+           "00000/00A00a0/00000/00B00b0/00000/00000 0",
+           "0000/00A00a0/00000/00B00b0/00000 0",
+           "000000/00A00a0/00000/00B00b0/00000 0",
+           "00000/00A00a0/00000/00B00b0/00005 0",
+           "00000/00A00A0/00000/00B00b0/00000 0",
+           "00000/00A00a0/00000/00B00000/00000 0",
+           "00000/00Aa000/00000/00B00b0/00000 0",
+           "00000/00A04a/00000/00B00b0/00000 0",
+           "A0000/000000a/00000/00B00b0/00000 0",
+           "00000/00A00a0/00000/00B00b0/00000 0x",
+           "00000/00A00c0/00000/00B00b0/00000 0",
+       }) {
+    Board board;
+    EXPECT_FALSE(Board::ParseNotation(notation, &board)) << notation;
+    EXPECT_EQ(board.hash(), Board().hash());
+  }
+}
+
 }  // namespace
 }  // namespace santorini
 
@@ -11,6 +11,12 @@ GameRunner::GameRunner(std::vector<std::unique_ptr<Player>> players)
   CHECK_EQ(players_.size(), 2);
 }
 
+GameRunner::GameRunner(std::vector<std::unique_ptr<Player>> players,
+                       const Board& board)
+    : GameRunner(std::move(players)) {
+  board_ = board;
+}
+
 int GameRunner::Step() {
   int winner = -1;
   const int move = players_[board_.current_player()]->SelectMove(board_);
@@ -16,6 +16,9 @@ class GameRunner {
  public:
   explicit GameRunner(std::vector<std::unique_ptr<Player>> players);
 
+  // Plays on from `board` instead of the start position.
+  GameRunner(std::vector<std::unique_ptr<Player>> players, const Board& board);
+
   // Step the game by one move.
   // If there is a winner, returns the index of the winning player.
   // Otherwise, returns -1.
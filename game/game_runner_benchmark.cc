@@ -6,23 +6,25 @@
 //   $ env CPUPROFILE=/tmp/benchmark.prof bazel-bin/game/game_runner_benchmark
 //   $ pprof -http=":8000" bazel-bin/game/game_runner_benchmark \
 //       /tmp/benchmark.prof
+//
+// To check a change for regressions against a baseline recorded with
+// tools/benchmarks.py update:
+//   $ tools/benchmarks.py compare
 
 #include <memory>
 #include <vector>
 
 #include "ai/random.h"
 #include "benchmark/benchmark.h"
+#include "game/allocation_counter.h"
+#include "game/benchmark_positions.h"
 #include "game/game_runner.h"
 
 namespace santorini {
 namespace {
 
-// -----------------------------------------------------
-// Benchmark           Time             CPU   Iterations
-// -----------------------------------------------------
-// BM_Rollout      77505 ns        77502 ns         9005 (initial)
-
 static void BM_Rollout(benchmark::State& state) {
+  const AllocationCounter allocations;
   for (auto _ : state) {
     std::vector<std::unique_ptr<Player>> players;
     players.push_back(std::make_unique<RandomAI>());
@@ -30,9 +32,35 @@ static void BM_Rollout(benchmark::State& state) {
     GameRunner game_runner(std::move(players));
     game_runner.Play();
   }
+  allocations.SetCounters(state);
 }
 BENCHMARK(BM_Rollout);
 
+// As above, from the corpus positions of the phase given by the argument in
+// turn. Random play from a real position runs far shorter or longer than
+// from the start, depending on the phase.
+static void BM_RolloutFromCorpus(benchmark::State& state) {
+  const GamePhase phase = static_cast<GamePhase>(state.range(0));
+  const std::vector<Board> boards = BenchmarkPositions(phase);
+  size_t next = 0;
+  int64_t moves = 0;
+  const AllocationCounter allocations;
+  for (auto _ : state) {
+    std::vector<std::unique_ptr<Player>> players;
+    players.push_back(std::make_unique<RandomAI>());
+    players.push_back(std::make_unique<RandomAI>());
+    GameRunner game_runner(std::move(players), boards[next]);
+    game_runner.Play();
+    moves += game_runner.current_turn();
+    next = (next + 1) % boards.size();
+  }
+  state.SetLabel(GamePhaseName(phase));
+  state.counters["moves"] = benchmark::Counter(
+      moves, benchmark::Counter::kAvgIterations);
+  allocations.SetCounters(state);
+}
+BENCHMARK(BM_RolloutFromCorpus)->DenseRange(0, kNumGamePhases - 1);
+
 }  // namespace
 }  // namespace santorini
 
@@ -0,0 +1,80 @@
+#include "game/packed_board.h"
+
+#include "game/board.h"
+
+namespace santorini {
+
+PackedBoard::PackedBoard(const Board& board) {
+  int square = 0;
+  for (int row = 0; row < Board::kNumRows; ++row) {
+    for (int col = 0; col < Board::kNumCols; ++col, ++square) {
+      const uint64_t height = board.height(row, col);
+      if (square < kSquaresInLow) {
+        low_ |= height << (3 * square);
+      } else {
+        high_ |= height << (3 * (square - kSquaresInLow));
+      }
+    }
+  }
+  for (int player : {0, 1}) {
+    for (int worker : {0, 1}) {
+      const int* position = board.worker(player, worker);
+      const uint64_t square = position[0] * Board::kNumCols + position[1];
+      high_ |= square << (kWorkerShift + 5 * (2 * player + worker));
+    }
+  }
+  low_ |= uint64_t(board.current_player()) << kPlayerShift;
+}
+
+PackedBoard::PackedBoard(const int heights[kNumSquares],
+                         const int workers[2][2], int current_player) {
+  for (int square = 0; square < kNumSquares; ++square) {
+    const uint64_t height = heights[square];
+    if (square < kSquaresInLow) {
+      low_ |= height << (3 * square);
+    } else {
+      high_ |= height << (3 * (square - kSquaresInLow));
+    }
+  }
+  for (int player : {0, 1}) {
+    for (int worker : {0, 1}) {
+      high_ |= uint64_t(workers[player][worker])
+               << (kWorkerShift + 5 * (2 * player + worker));
+    }
+  }
+  low_ |= uint64_t(current_player) << kPlayerShift;
+}
+
+PackedBoard PackedBoard::FromWords(uint64_t low, uint64_t high) {
+  PackedBoard board;
+  board.low_ = low;
+  board.high_ = high & ((uint64_t{1} << (kNumBits - 64)) - 1);
+  return board;
+}
+
+Board PackedBoard::Unpack() const {
+  int heights[Board::kNumRows][Board::kNumCols];
+  for (int row = 0; row < Board::kNumRows; ++row) {
+    for (int col = 0; col < Board::kNumCols; ++col) {
+      heights[row][col] = height(row, col);
+    }
+  }
+  int workers[2][2][2];
+  for (int player : {0, 1}) {
+    for (int w : {0, 1}) {
+      workers[player][w][0] = worker(player, w) / Board::kNumCols;
+      workers[player][w][1] = worker(player, w) % Board::kNumCols;
+    }
+  }
+  return Board(heights, workers, current_player());
+}
+
+uint64_t PackedBoard::hash() const {
+  // Both words through the splitmix64 finalizer.
+  uint64_t z = low_ ^ (high_ * 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+}  // namespace santorini
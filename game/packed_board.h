@@ -0,0 +1,90 @@
+#ifndef SANTORINI_GAME_PACKED_BOARD_H_
+#define SANTORINI_GAME_PACKED_BOARD_H_
+
+#include <cstdint>
+#include <utility>
+
+#include "game/board.h"
+
+namespace santorini {
+
+// A position packed into 16 bytes: 3 bits of height for each of the 25
+// squares, 5 bits of square for each of the 4 workers, in player and worker
+// order, and the player to move, 96 bits in all. The move history is not
+// kept.
+//
+// This is the key for anything that stores positions and has to tell them
+// apart exactly, such as books, training records and caches. Board is far
+// bigger, and Board::hash() can collide.
+class PackedBoard {
+ public:
+  static constexpr int kNumSquares = Board::kNumRows * Board::kNumCols;
+
+  // The number of bits in use; the rest are zero.
+  static constexpr int kNumBits = 96;
+
+  PackedBoard() = default;
+
+  explicit PackedBoard(const Board& board);
+
+  // Packs a position given as heights by square (row * 5 + col), worker
+  // squares by player and worker, and the player to move.
+  PackedBoard(const int heights[kNumSquares], const int workers[2][2],
+              int current_player);
+
+  // Packed bits as two words, for serialization: the low word, and the high
+  // word, of which only the low kNumBits - 64 bits are used.
+  static PackedBoard FromWords(uint64_t low, uint64_t high);
+  uint64_t low() const { return low_; }
+  uint64_t high() const { return high_; }
+
+  // Returns the position as a board with no move history.
+  Board Unpack() const;
+
+  int height(int square) const {
+    return square < kSquaresInLow
+               ? low_ >> (3 * square) & 7
+               : high_ >> (3 * (square - kSquaresInLow)) & 7;
+  }
+  int height(int row, int col) const {
+    return height(row * Board::kNumCols + col);
+  }
+  // The square of a worker, as row * 5 + col.
+  int worker(int player, int worker) const {
+    return high_ >> (kWorkerShift + 5 * (2 * player + worker)) & 31;
+  }
+  int current_player() const { return low_ >> kPlayerShift; }
+
+  // A well-mixed hash of the position. This is not Board::hash().
+  uint64_t hash() const;
+
+  bool operator==(const PackedBoard& other) const {
+    return low_ == other.low_ && high_ == other.high_;
+  }
+  bool operator!=(const PackedBoard& other) const { return !(*this == other); }
+  // An arbitrary total order, for sorted tables.
+  bool operator<(const PackedBoard& other) const {
+    return high_ != other.high_ ? high_ < other.high_ : low_ < other.low_;
+  }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const PackedBoard& board) {
+    return H::combine(std::move(h), board.low_, board.high_);
+  }
+
+ private:
+  // The low word has the heights of the first 21 squares, then the player
+  // to move in its top bit. The high word has the heights of the last 4
+  // squares, then the workers.
+  static constexpr int kSquaresInLow = 21;
+  static constexpr int kPlayerShift = 63;
+  static constexpr int kWorkerShift = 3 * (kNumSquares - kSquaresInLow);
+
+  uint64_t low_ = 0;
+  uint64_t high_ = 0;
+};
+static_assert(sizeof(PackedBoard) == 16);
+
+}  // namespace santorini
+
+#endif
@@ -0,0 +1,89 @@
+#include "game/packed_board.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "game/board.h"
+#include "gtest/gtest.h"
+
+namespace santorini {
+namespace {
+
+// Returns the positions of a few games of random moves.
+std::vector<Board> RandomPositions() {
+  srand(11);
+  std::vector<Board> positions;
+  for (int game = 0; game < 20; ++game) {
+    Board board;
+    positions.push_back(board);
+    while (board.winner() == -1) {
+      const std::vector<Board::Move> moves = board.PossibleMoves();
+      if (moves.empty()) break;
+      board.MakeMove(moves[rand() % moves.size()].move_id);
+      positions.push_back(board);
+    }
+  }
+  return positions;
+}
+
+TEST(PackedBoardTest, UnpackRestoresPosition) {
+  for (const Board& board : RandomPositions()) {
+    const PackedBoard packed(board);
+    const Board unpacked = packed.Unpack();
+    EXPECT_EQ(PackedBoard(unpacked), packed);
+    EXPECT_EQ(unpacked.hash(), board.hash());
+    EXPECT_EQ(unpacked.current_player(), board.current_player());
+    EXPECT_EQ(unpacked.winner(), board.winner());
+    EXPECT_EQ(unpacked.PossibleMoveMask(), board.PossibleMoveMask());
+    EXPECT_TRUE(unpacked.past_moves().empty());
+  }
+}
+
+TEST(PackedBoardTest, Accessors) {
+  Board board;
+  board.MakeMove(board.PossibleMoves().front().move_id);
+  const PackedBoard packed(board);
+  for (int row = 0; row < Board::kNumRows; ++row) {
+    for (int col = 0; col < Board::kNumCols; ++col) {
+      EXPECT_EQ(packed.height(row, col), board.height(row, col));
+    }
+  }
+  for (int player : {0, 1}) {
+    for (int worker : {0, 1}) {
+      const int* square = board.worker(player, worker);
+      EXPECT_EQ(packed.worker(player, worker),
+                square[0] * Board::kNumCols + square[1]);
+    }
+  }
+  EXPECT_EQ(packed.current_player(), 1);
+}
+
+TEST(PackedBoardTest, EqualOnlyForSamePosition) {
+  const std::vector<Board> positions = RandomPositions();
+  absl::flat_hash_set<PackedBoard> packed;
+  absl::flat_hash_set<uint64_t> hashes;
+  absl::flat_hash_set<uint64_t> board_hashes;
+  for (const Board& board : positions) {
+    packed.insert(PackedBoard(board));
+    hashes.insert(PackedBoard(board).hash());
+    board_hashes.insert(board.hash());
+  }
+  // Every game starts from the same position, and otherwise positions
+  // rarely repeat.
+  EXPECT_EQ(packed.size(), board_hashes.size());
+  EXPECT_EQ(hashes.size(), packed.size());
+}
+
+TEST(PackedBoardTest, FromWords) {
+  Board board;
+  board.MakeMove(board.PossibleMoves().back().move_id);
+  const PackedBoard packed(board);
+  EXPECT_EQ(packed.high() >> (PackedBoard::kNumBits - 64), 0);
+  EXPECT_EQ(PackedBoard::FromWords(packed.low(), packed.high()), packed);
+  EXPECT_EQ(PackedBoard::FromWords(packed.low(), packed.high() | ~0ULL << 32),
+            packed);
+}
+
+}  // namespace
+}  // namespace santorini
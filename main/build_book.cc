@@ -0,0 +1,124 @@
+// Builds an opening book for MctsAI, see ai/opening_book.h.
+//
+// Every position in the first --plies moves of the game, up to symmetry, is
+// searched with a deep MCTS search, and the best move is written to the
+// book. Positions are searched in parallel, one per thread. For example:
+//
+//   $ bazel run -c opt main:build_book -- --plies=2 --output=/tmp/book
+//   $ bazel run -c opt main:run_games -- --opening_book=/tmp/book
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/log/check.h"
+#include "absl/log/globals.h"
+#include "absl/log/initialize.h"
+#include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ai/mcts.h"
+#include "ai/opening_book.h"
+#include "game/board.h"
+#include "game/packed_board.h"
+
+ABSL_FLAG(std::string, output, "", "Where to write the book.");
+ABSL_FLAG(int, plies, 2, "Book positions with fewer than this many moves.");
+ABSL_FLAG(int, iterations, 10000000, "MCTS iterations per position.");
+ABSL_FLAG(int, threads, 1, "Number of positions to search in parallel.");
+
+namespace santorini {
+
+// Returns every position with fewer than `plies` moves played, keeping one
+// of each set of symmetric positions. Positions that are over, or have only
+// one move, are left out since MctsAI doesn't search them.
+std::vector<Board> BookPositions(int plies) {
+  std::vector<Board> positions;
+  absl::flat_hash_set<PackedBoard> seen;
+  std::vector<Board> frontier = {Board()};
+  for (int ply = 0; ply < plies; ++ply) {
+    std::vector<Board> next;
+    for (const Board& board : frontier) {
+      const std::vector<Board::Move> moves = board.PossibleMoves();
+      if (moves.size() < 2) continue;
+      positions.push_back(board);
+      if (ply + 1 == plies) continue;
+      for (const Board::Move& move : moves) {
+        if (move.is_winning) continue;
+        Board child = board;
+        CHECK(child.MakeMove(move.move_id));
+        if (seen.insert(CanonicalPosition(child)).second) {
+          next.push_back(child);
+        }
+      }
+    }
+    frontier = std::move(next);
+  }
+  return positions;
+}
+
+// Searches `board` and returns its book entry.
+BookEntry SearchPosition(const Board& board, int iterations) {
+  MctsAI ai(board.current_player(),
+            MctsOptions{.num_iterations = iterations});
+  const int move = ai.SelectMove(board);
+
+  int symmetry;
+  BookEntry entry;
+  entry.position = CanonicalPosition(board, &symmetry);
+  entry.move = EncodeBookMove(board, move, symmetry);
+  entry.ply = board.past_moves().size();
+  for (const auto& child : ai.prev_tree()->children) {
+    if (child->move == move) {
+      entry.visits = child->visits;
+      entry.win_rate = child->wins / child->visits;
+    }
+  }
+  return entry;
+}
+
+}  // namespace santorini
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  absl::InitializeLog();
+  absl::SetStderrThreshold(absl::LogSeverityAtLeast::kInfo);
+  const std::string output = absl::GetFlag(FLAGS_output);
+  CHECK(!output.empty()) << "--output is required";
+
+  const std::vector<santorini::Board> positions =
+      santorini::BookPositions(absl::GetFlag(FLAGS_plies));
+  LOG(INFO) << "Searching " << positions.size() << " positions";
+
+  const absl::Time start = absl::Now();
+  std::vector<santorini::BookEntry> entries(positions.size());
+  std::atomic<int> next(0);
+  std::mutex log_mutex;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < absl::GetFlag(FLAGS_threads); ++i) {
+    threads.emplace_back([&]() {
+      for (int p = next.fetch_add(1); p < static_cast<int>(positions.size());
+           p = next.fetch_add(1)) {
+        entries[p] = santorini::SearchPosition(
+            positions[p], absl::GetFlag(FLAGS_iterations));
+        std::lock_guard<std::mutex> lock(log_mutex);
+        LOG(INFO) << "Position " << p + 1 << "/" << positions.size()
+                  << " at ply " << entries[p].ply << ": "
+                  << entries[p].visits << " visits, win rate "
+                  << entries[p].win_rate << " (" << (absl::Now() - start)
+                  << ")";
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  if (!santorini::WriteOpeningBook(output, std::move(entries))) return 1;
+  LOG(INFO) << "Wrote " << positions.size() << " positions to " << output;
+  return 0;
+}
@@ -1,18 +1,288 @@
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/log/globals.h"
 #include "absl/log/initialize.h"
+#include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ai/alpha_beta.h"
+#include "ai/eval_service.h"
 #include "ai/mcts.h"
+#include "ai/network.h"
+#include "ai/opening_book.h"
 #include "ai/random.h"
+#include "ai/training_data.h"
+#include "ai/warm_tree.h"
+#include "game/benchmark_positions.h"
+#include "game/board.h"
 #include "game/game_runner.h"
 
 ABSL_FLAG(int, seed, -1, "Random number seed. If -1, use time.");
 ABSL_FLAG(int, num_games, 10, "Number of games to play.");
-ABSL_FLAG(bool, print_board, false, "Print the board during play.");
+ABSL_FLAG(int, game_threads, 1,
+          "Games played at once. Each game has its own players, seeded from "
+          "--seed and the game's index, so results don't depend on the "
+          "number of threads unless the players share state.");
+ABSL_FLAG(bool, print_board, false,
+          "Print the board during play. Requires --game_threads=1.");
+ABSL_FLAG(std::string, player0, "mcts",
+          "Engine for player 0, one of: mcts, alphabeta, random.");
+ABSL_FLAG(std::string, player1, "mcts",
+          "Engine for player 1, one of: mcts, alphabeta, random.");
+ABSL_FLAG(int, alphabeta_depth, 8, "Maximum search depth for alphabeta.");
+ABSL_FLAG(absl::Duration, alphabeta_time, absl::ZeroDuration(),
+          "If positive, the time limit per move for alphabeta.");
+ABSL_FLAG(std::string, opening_book, "",
+          "If set, mcts plays from this opening book, see main/build_book.cc.");
+ABSL_FLAG(bool, warm_tree, false,
+          "If true, mcts players share search trees of early positions "
+          "across games.");
+ABSL_FLAG(int, warm_tree_mb, 1024, "Memory limit for --warm_tree.");
+ABSL_FLAG(std::string, network, "",
+          "If set, mcts searches with PUCT and this network instead of "
+          "rollouts.");
+ABSL_FLAG(int, mcts_iterations, 1000000, "Iterations per move for mcts.");
+ABSL_FLAG(int, mcts_threads, 1, "Search threads per mcts player.");
+ABSL_FLAG(int, eval_batch_size, 0,
+          "If positive, --network evaluations are batched across threads "
+          "up to this size, with virtual loss.");
+ABSL_FLAG(std::string, selfplay_output, "",
+          "If set, mcts plays itself, and every position is written with its "
+          "root visits and the game result to record files named "
+          "<prefix>-<shard>-of-<shards>, see ai/training_data.h. Each of "
+          "the --game_threads writes its own shard.");
+ABSL_FLAG(bool, selfplay_compress, true, "Compress self-play records.");
+ABSL_FLAG(bool, bench, false,
+          "If true, instead of playing games, search a fixed set of positions "
+          "with mcts, a fixed seed and one thread, then print the total "
+          "number of tree nodes, which changes with any change to what the "
+          "search does, and the speed.");
+ABSL_FLAG(int, bench_iterations, 5000, "Iterations per position for --bench.");
+
+// Objects shared by all players in the process.
+struct SharedState {
+  std::unique_ptr<santorini::OpeningBook> opening_book;
+  std::unique_ptr<santorini::WarmTree> warm_tree;
+  std::unique_ptr<santorini::Network> network;
+  std::unique_ptr<santorini::EvalService> eval_service;
+};
+
+// Returns the seed for `player_id` in game `game`, from the match seed.
+int64_t PlayerSeed(uint64_t seed, int game, int player_id) {
+  std::seed_seq seq{static_cast<uint32_t>(seed),
+                    static_cast<uint32_t>(seed >> 32),
+                    static_cast<uint32_t>(game),
+                    static_cast<uint32_t>(player_id)};
+  // Non-negative, as -1 asks MctsAI for a random seed.
+  return std::mt19937_64(seq)() >> 1;
+}
+
+santorini::MctsOptions MctsPlayerOptions(int player_id,
+                                         const SharedState &shared,
+                                         int64_t seed) {
+  // Player 0 explores slightly less, as in the original setup.
+  return santorini::MctsOptions{
+      .c = player_id == 0 ? 1.3 : 1.4,
+      .num_iterations = absl::GetFlag(FLAGS_mcts_iterations),
+      .num_rollouts_per_iteration = 1,
+      .num_threads = absl::GetFlag(FLAGS_mcts_threads),
+      .opening_book = shared.opening_book.get(),
+      .warm_tree = shared.warm_tree.get(),
+      .network = shared.network.get(),
+      .eval_service = shared.eval_service.get(),
+      .virtual_loss = shared.eval_service != nullptr ? 1 : 0,
+      .seed = seed};
+}
+
+std::unique_ptr<santorini::Player> MakePlayer(const std::string &engine,
+                                              int player_id,
+                                              const SharedState &shared,
+                                              int64_t seed) {
+  if (engine == "mcts") {
+    return std::make_unique<santorini::MctsAI>(
+        player_id, MctsPlayerOptions(player_id, shared, seed));
+  }
+  if (engine == "alphabeta") {
+    return std::make_unique<santorini::AlphaBetaAI>(
+        player_id, santorini::AlphaBetaOptions{
+                       .max_depth = absl::GetFlag(FLAGS_alphabeta_depth),
+                       .max_time = absl::GetFlag(FLAGS_alphabeta_time)});
+  }
+  if (engine == "random") {
+    return std::make_unique<santorini::RandomAI>(seed);
+  }
+  LOG(FATAL) << "Unknown engine: " << engine;
+}
+
+// Plays game `game` of the match between --player0 and --player1. Returns
+// the winner.
+int PlayGame(const SharedState &shared, uint64_t seed, int game) {
+  std::vector<std::unique_ptr<santorini::Player>> players;
+  for (int player_id : {0, 1}) {
+    players.push_back(MakePlayer(
+        absl::GetFlag(player_id == 0 ? FLAGS_player0 : FLAGS_player1),
+        player_id, shared, PlayerSeed(seed, game, player_id)));
+  }
+  santorini::GameRunner game_runner(std::move(players));
+  if (absl::GetFlag(FLAGS_print_board)) {
+    game_runner.AddObserver(santorini::BoardPrintingObserver());
+  }
+  return game_runner.Play();
+}
+
+// Calls `play_game(thread, game)` for every game of --num_games on
+// `num_threads` threads, each taking the next game as it finishes one, and
+// adds the winners to `wins`. Logs the progress.
+void PlayGames(int num_threads,
+               const std::function<int(int thread, int game)> &play_game,
+               int wins[2]) {
+  const int num_games = absl::GetFlag(FLAGS_num_games);
+  const absl::Time start = absl::Now();
+  std::atomic<int> next_game(0);
+  std::mutex mutex;
+  int games_played = 0;
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < num_threads; ++thread) {
+    threads.emplace_back([&, thread]() {
+      for (int game = next_game++; game < num_games; game = next_game++) {
+        const int winner = play_game(thread, game);
+        std::lock_guard<std::mutex> lock(mutex);
+        ++wins[winner];
+        if (++games_played % std::max(1, num_games / 10) == 0) {
+          LOG(INFO) << games_played << "/" << num_games << " games, "
+                    << wins[0] << ":" << wins[1] << " ("
+                    << (absl::Now() - start) << ")";
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+// Plays game `game` of mcts against itself, writing its positions to
+// `writer`. Returns the winner.
+int PlaySelfPlayGame(const SharedState &shared, uint64_t seed, int game,
+                     santorini::RecordWriter *writer) {
+  std::unique_ptr<santorini::MctsAI> players[2];
+  for (int player_id : {0, 1}) {
+    players[player_id] = std::make_unique<santorini::MctsAI>(
+        player_id, MctsPlayerOptions(player_id, shared,
+                                     PlayerSeed(seed, game, player_id)));
+  }
+
+  santorini::Board board;
+  std::vector<santorini::TrainingRecord> records;
+  int winner = -1;
+  while (winner == -1) {
+    santorini::MctsAI &player = *players[board.current_player()];
+    const int move = player.SelectMove(board);
+    santorini::TrainingRecord &record = records.emplace_back();
+    santorini::SetPosition(board, &record);
+    for (const auto &[move_id, visits] :
+         player.last_search_stats().root_visits) {
+      record.visits.push_back({move_id, visits});
+    }
+    CHECK(board.MakeMove(move));
+    // As in GameRunner, a player who is out of moves loses.
+    winner = board.winner();
+    if (winner == -1 && board.PossibleMoves().empty()) {
+      winner = !board.current_player();
+    }
+  }
+
+  for (santorini::TrainingRecord &record : records) {
+    record.winner = winner;
+    writer->Write(record);
+  }
+  return winner;
+}
+
+// Plays --num_games games of self-play on `num_threads` threads, with one
+// shard per thread. Returns false if the output can't be written.
+bool RunSelfPlay(const SharedState &shared, uint64_t seed, int num_threads,
+                 int wins[2]) {
+  const std::string prefix = absl::GetFlag(FLAGS_selfplay_output);
+  const int num_shards = num_threads;
+
+  std::vector<std::unique_ptr<santorini::RecordWriter>> writers;
+  for (int shard = 0; shard < num_shards; ++shard) {
+    writers.push_back(santorini::RecordWriter::Open(
+        absl::StrFormat("%s-%05d-of-%05d", prefix, shard, num_shards),
+        {.compress = absl::GetFlag(FLAGS_selfplay_compress)}));
+    if (writers.back() == nullptr) return false;
+  }
+
+  // Each thread writes its own shard.
+  PlayGames(
+      num_shards,
+      [&](int thread, int game) {
+        return PlaySelfPlayGame(shared, seed, game, writers[thread].get());
+      },
+      wins);
+
+  int64_t positions = 0;
+  for (const auto &writer : writers) {
+    positions += writer->records_written();
+  }
+  LOG(INFO) << "Wrote " << positions << " positions to " << num_shards
+            << " shards of " << prefix;
+  return true;
+}
+
+// Searches --bench_iterations iterations from each of a fixed sample of the
+// benchmark positions, and prints the nodes of each search tree and their
+// total, and the speed.
+void RunBench() {
+  constexpr int kPositionsPerPhase = 8;
+  constexpr int64_t kBenchSeed = 1;
+  int64_t nodes = 0;
+  int64_t iterations = 0;
+  absl::Duration elapsed;
+  int index = 0;
+  for (int phase = 0; phase < santorini::kNumGamePhases; ++phase) {
+    for (const santorini::Board &board : santorini::BenchmarkPositions(
+             static_cast<santorini::GamePhase>(phase), kPositionsPerPhase)) {
+      santorini::MctsAI ai(
+          board.current_player(),
+          santorini::MctsOptions{
+              .num_iterations = absl::GetFlag(FLAGS_bench_iterations),
+              .seed = kBenchSeed});
+      const absl::Time start = absl::Now();
+      const int move = ai.SelectMove(board);
+      elapsed += absl::Now() - start;
+      // A forced move is played without a search tree.
+      const int64_t tree_nodes =
+          ai.prev_tree() != nullptr
+              ? santorini::MeasureTree(*ai.prev_tree()).nodes
+              : 1;
+      nodes += tree_nodes;
+      iterations += ai.last_search_stats().iterations;
+      absl::PrintF("%2d  %-36s %-22s %9d nodes\n", ++index,
+                   board.ToNotation(), santorini::MoveDebugString(move),
+                   tree_nodes);
+    }
+  }
+  const double seconds = absl::ToDoubleSeconds(elapsed);
+  absl::PrintF("\nTotal time (ms) : %d\n", absl::ToInt64Milliseconds(elapsed));
+  absl::PrintF("Nodes searched  : %d\n", nodes);
+  absl::PrintF("Nodes/second    : %.0f\n", nodes / seconds);
+  absl::PrintF("Iterations/s    : %.0f\n", iterations / seconds);
+}
 
 int main(int argc, char **argv) {
   // Initialize command line flags and logging.
@@ -21,39 +291,59 @@ int main(int argc, char **argv) {
 
   absl::SetStderrThreshold(absl::LogSeverityAtLeast::kInfo);
 
-  if (absl::GetFlag(FLAGS_seed) != -1) {
-    srand(absl::GetFlag(FLAGS_seed));
-  } else {
-    srand(time(NULL));
+  if (absl::GetFlag(FLAGS_bench)) {
+    RunBench();
+    return 0;
+  }
+
+  const uint64_t seed = absl::GetFlag(FLAGS_seed) != -1
+                            ? absl::GetFlag(FLAGS_seed)
+                            : time(NULL);
+  LOG(INFO) << "Seed " << seed;
+  const int game_threads = absl::GetFlag(FLAGS_game_threads);
+  CHECK_GE(game_threads, 1);
+  CHECK(game_threads == 1 || !absl::GetFlag(FLAGS_print_board))
+      << "--print_board requires --game_threads=1";
+
+  SharedState shared;
+  if (!absl::GetFlag(FLAGS_opening_book).empty()) {
+    shared.opening_book =
+        santorini::OpeningBook::Open(absl::GetFlag(FLAGS_opening_book));
+    if (shared.opening_book == nullptr) return 1;
+  }
+  if (absl::GetFlag(FLAGS_warm_tree)) {
+    shared.warm_tree = std::make_unique<santorini::WarmTree>(
+        santorini::WarmTreeOptions{
+            .max_bytes = int64_t{absl::GetFlag(FLAGS_warm_tree_mb)} << 20});
+  }
+  if (!absl::GetFlag(FLAGS_network).empty()) {
+    shared.network = santorini::Network::Load(absl::GetFlag(FLAGS_network));
+    if (shared.network == nullptr) return 1;
+    if (absl::GetFlag(FLAGS_eval_batch_size) > 0) {
+      shared.eval_service = std::make_unique<santorini::EvalService>(
+          shared.network.get(),
+          santorini::EvalServiceOptions{
+              .max_batch_size = absl::GetFlag(FLAGS_eval_batch_size)});
+    }
   }
 
   int wins[2] = {0, 0};
 
   absl::Time start = absl::Now();
   const int num_games = absl::GetFlag(FLAGS_num_games);
-  for (int i = 0; i < num_games; ++i) {
-    std::vector<std::unique_ptr<santorini::Player>> players;
-    players.push_back(std::make_unique<santorini::MctsAI>(
-        0, santorini::MctsOptions{.c = 1.3,
-                                  .num_iterations = 1000000,
-                                  .num_rollouts_per_iteration = 1,
-                                  .num_threads = 1}));
-    players.push_back(std::make_unique<santorini::MctsAI>(
-        1, santorini::MctsOptions{.num_iterations = 1000000,
-                                  .num_rollouts_per_iteration = 1,
-                                  .num_threads = 1}));
-    santorini::GameRunner game_runner(std::move(players));
-
-    if (absl::GetFlag(FLAGS_print_board)) {
-      game_runner.AddObserver(santorini::BoardPrintingObserver());
-    }
-
-    const int winner = game_runner.Play();
-    wins[winner] += 1;
+  if (!absl::GetFlag(FLAGS_selfplay_output).empty()) {
+    if (!RunSelfPlay(shared, seed, game_threads, wins)) return 1;
+  } else {
+    PlayGames(
+        game_threads,
+        [&](int /*thread*/, int game) { return PlayGame(shared, seed, game); },
+        wins);
   }
   absl::Time end = absl::Now();
 
-  LOG(INFO) << "Played " << num_games << " games in " << (end - start);
+  LOG(INFO) << "Played " << num_games << " games in " << (end - start)
+            << absl::StrFormat(" (%.1f games/hour)",
+                               num_games / absl::ToDoubleHours(end - start));
   LOG(INFO) << "Wins: ";
   LOG(INFO) << "  player[0]=" << wins[0];
   LOG(INFO) << "  player[1]=" << wins[1];
@@ -0,0 +1,97 @@
+// Decides Santorini positions exactly with proof-number search.
+//
+// Positions are read from stdin, one per line, either as the move ids played
+// from the start of the game, separated by spaces, or in the notation of
+// Board::ToNotation. Empty lines and lines starting with '#' are skipped.
+// For example:
+//
+//   $ echo "12 76 3" | bazel run -c opt main:solve
+//   $ bazel run -c opt main:solve < game/testdata/positions.txt
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/log/globals.h"
+#include "absl/log/initialize.h"
+#include "absl/log/log.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ai/proof_number.h"
+#include "game/board.h"
+
+ABSL_FLAG(int, memory_mb, 256, "Memory for the transposition table.");
+ABSL_FLAG(int64_t, max_nodes, 100000000,
+          "Give up on a position after this many nodes.");
+
+namespace santorini {
+
+// Parses a line of move ids or a position in notation into `board`.
+// Returns false on a malformed line or an invalid move.
+bool ParsePosition(absl::string_view line, Board* board) {
+  if (absl::StrContains(line, '/')) return Board::ParseNotation(line, board);
+  for (absl::string_view token :
+       absl::StrSplit(line, ' ', absl::SkipWhitespace())) {
+    int move_id;
+    if (!absl::SimpleAtoi(token, &move_id) || move_id < 0 || move_id >= 128 ||
+        !board->MakeMove(move_id)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const char* OutcomeString(ProofResult::Outcome outcome) {
+  switch (outcome) {
+    case ProofResult::kWin:
+      return "win";
+    case ProofResult::kLoss:
+      return "loss";
+    case ProofResult::kUnknown:
+      return "unknown";
+  }
+  return "?";
+}
+
+}  // namespace santorini
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  absl::InitializeLog();
+  absl::SetStderrThreshold(absl::LogSeverityAtLeast::kInfo);
+
+  santorini::ProofNumberSolver solver(santorini::ProofNumberOptions{
+      .memory_bytes = int64_t{absl::GetFlag(FLAGS_memory_mb)} << 20,
+      .max_nodes = absl::GetFlag(FLAGS_max_nodes)});
+
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    const absl::string_view stripped = absl::StripAsciiWhitespace(line);
+    if (stripped.empty() || stripped[0] == '#') continue;
+
+    santorini::Board board;
+    if (!santorini::ParsePosition(stripped, &board)) {
+      LOG(ERROR) << "Invalid position: " << line;
+      continue;
+    }
+    const absl::Time start = absl::Now();
+    const santorini::ProofResult result = solver.Solve(board);
+    const absl::Duration elapsed = absl::Now() - start;
+
+    std::cout << line << "\n  player " << board.current_player()
+              << " to move: " << santorini::OutcomeString(result.outcome)
+              << " (" << result.nodes << " nodes, " << elapsed << ")\n";
+    for (int move : result.line) {
+      std::cout << "  " << santorini::MoveDebugString(move) << "\n";
+    }
+    if (result.line_truncated) {
+      std::cout << "  (line truncated: raise --max_nodes or --memory_mb)\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,235 @@
+// Trains a value and policy network for MctsAI on self-play records, see
+// ai/network_trainer.h and ai/training_data.h.
+//
+// Record files are read through a shuffle buffer: each record replaces a
+// random one in the buffer, which is sent to training instead, so that
+// batches mix positions from many games. Batches are trained on by all
+// threads at once, Hogwild style. For example, to play 1000 games of self-play
+// on 8 threads, train on their records, and play with the network:
+//
+//   $ bazel run -c opt main:run_games -- --selfplay_output=/tmp/selfplay
+//         --game_threads=8 --num_games=1000 --mcts_iterations=20000
+//   $ bazel run -c opt main:train_network --
+//         --input=/tmp/selfplay-00000-of-00008,... --output=/tmp/network
+//   $ bazel run -c opt main:run_games -- --network=/tmp/network
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/log/check.h"
+#include "absl/log/globals.h"
+#include "absl/log/initialize.h"
+#include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ai/network.h"
+#include "ai/network_trainer.h"
+#include "ai/training_data.h"
+
+ABSL_FLAG(std::vector<std::string>, input, {},
+          "Comma-separated self-play record files.");
+ABSL_FLAG(std::string, output, "", "Where to write the network.");
+ABSL_FLAG(std::string, init, "",
+          "If set, continue training this network instead of a new one.");
+ABSL_FLAG(int, hidden_size, 128, "Width of the trunk of a new network.");
+ABSL_FLAG(int, num_hidden_layers, 2, "Depth of the trunk of a new network.");
+ABSL_FLAG(int, epochs, 1, "Passes over the input.");
+ABSL_FLAG(int, batch_size, 64, "Examples per SGD step.");
+ABSL_FLAG(double, learning_rate, 0.01, "SGD learning rate.");
+ABSL_FLAG(double, weight_decay, 1e-4, "L2 regularization of the weights.");
+ABSL_FLAG(int, shuffle_buffer, 100000, "Records in the shuffle buffer.");
+ABSL_FLAG(int, threads, std::max(1u, std::thread::hardware_concurrency()),
+          "Training threads.");
+ABSL_FLAG(int, log_every, 1000, "Log the loss every this many batches.");
+ABSL_FLAG(int, seed, 1, "Seed for new weights and shuffling.");
+
+namespace santorini {
+
+// Batches handed from the reader to the training threads. Push blocks while
+// the queue is full, so the reader stays only a little ahead.
+class BatchQueue {
+ public:
+  explicit BatchQueue(size_t capacity) : capacity_(capacity) {}
+
+  void Push(std::vector<TrainingExample> batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this]() { return batches_.size() < capacity_; });
+    batches_.push_back(std::move(batch));
+    not_empty_.notify_one();
+  }
+
+  // Returns false once the queue is closed and empty.
+  bool Pop(std::vector<TrainingExample>* batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this]() { return closed_ || !batches_.empty(); });
+    if (batches_.empty()) return false;
+    *batch = std::move(batches_.front());
+    batches_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+
+ private:
+  const size_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<std::vector<TrainingExample>> batches_;
+  bool closed_ = false;
+};
+
+// Gathers examples into batches for `queue`.
+class Batcher {
+ public:
+  Batcher(int batch_size, BatchQueue* queue)
+      : batch_size_(batch_size), queue_(queue) {}
+
+  void Add(const TrainingRecord& record) {
+    if (batch_.empty()) batch_.reserve(batch_size_);
+    if (!MakeTrainingExample(record, &batch_.emplace_back())) {
+      batch_.pop_back();
+      return;
+    }
+    if (static_cast<int>(batch_.size()) == batch_size_) {
+      queue_->Push(std::move(batch_));
+      batch_.clear();
+    }
+  }
+
+  // Pushes the last batch, if it is partial.
+  void Flush() {
+    if (batch_.empty()) return;
+    queue_->Push(std::move(batch_));
+    batch_.clear();
+  }
+
+ private:
+  const int batch_size_;
+  BatchQueue* queue_;
+  std::vector<TrainingExample> batch_;
+};
+
+// Reads all of `paths` once, in a random order, through a shuffle buffer of
+// `buffer_size` records. Returns the number of records read.
+int64_t ReadEpoch(std::vector<std::string> paths, int buffer_size,
+                  std::mt19937_64* rng, Batcher* batcher) {
+  std::shuffle(paths.begin(), paths.end(), *rng);
+  std::vector<TrainingRecord> buffer;
+  buffer.reserve(buffer_size);
+  int64_t num_records = 0;
+  TrainingRecord record;
+  for (const std::string& path : paths) {
+    std::unique_ptr<RecordReader> reader = RecordReader::Open(path);
+    if (reader == nullptr) continue;
+    while (reader->Next(&record)) {
+      ++num_records;
+      if (static_cast<int>(buffer.size()) < buffer_size) {
+        buffer.push_back(record);
+        continue;
+      }
+      std::uniform_int_distribution<size_t> pick(0, buffer.size() - 1);
+      std::swap(buffer[pick(*rng)], record);
+      batcher->Add(record);
+    }
+  }
+  std::shuffle(buffer.begin(), buffer.end(), *rng);
+  for (const TrainingRecord& rest : buffer) {
+    batcher->Add(rest);
+  }
+  return num_records;
+}
+
+}  // namespace santorini
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  absl::InitializeLog();
+  absl::SetStderrThreshold(absl::LogSeverityAtLeast::kInfo);
+  const std::vector<std::string> inputs = absl::GetFlag(FLAGS_input);
+  const std::string output = absl::GetFlag(FLAGS_output);
+  CHECK(!inputs.empty()) << "--input is required";
+  CHECK(!output.empty()) << "--output is required";
+  CHECK_GT(absl::GetFlag(FLAGS_batch_size), 0);
+  CHECK_GT(absl::GetFlag(FLAGS_shuffle_buffer), 0);
+
+  std::unique_ptr<santorini::Network> network;
+  if (!absl::GetFlag(FLAGS_init).empty()) {
+    network = santorini::Network::Load(absl::GetFlag(FLAGS_init));
+    if (network == nullptr) return 1;
+  } else {
+    network = std::make_unique<santorini::Network>(
+        santorini::NetworkShape{
+            .hidden_size = absl::GetFlag(FLAGS_hidden_size),
+            .num_hidden_layers = absl::GetFlag(FLAGS_num_hidden_layers)},
+        absl::GetFlag(FLAGS_seed));
+  }
+  santorini::NetworkTrainer trainer(
+      network.get(),
+      {.learning_rate = static_cast<float>(absl::GetFlag(FLAGS_learning_rate)),
+       .weight_decay = static_cast<float>(absl::GetFlag(FLAGS_weight_decay))});
+
+  std::mt19937_64 rng(absl::GetFlag(FLAGS_seed));
+  const int num_threads = absl::GetFlag(FLAGS_threads);
+  const int log_every = absl::GetFlag(FLAGS_log_every);
+  const absl::Time start = absl::Now();
+  for (int epoch = 0; epoch < absl::GetFlag(FLAGS_epochs); ++epoch) {
+    santorini::BatchQueue queue(2 * num_threads);
+    std::mutex loss_mutex;
+    santorini::TrainingLoss loss;
+    int64_t num_batches = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&]() {
+        std::vector<santorini::TrainingExample> batch;
+        while (queue.Pop(&batch)) {
+          const santorini::TrainingLoss batch_loss =
+              trainer.Step(batch.data(), batch.size());
+          std::lock_guard<std::mutex> lock(loss_mutex);
+          loss.value += batch_loss.value;
+          loss.policy += batch_loss.policy;
+          if (++num_batches % log_every == 0) {
+            LOG(INFO) << "Epoch " << epoch << ", batch " << num_batches
+                      << ": value loss " << loss.value / log_every
+                      << ", policy loss " << loss.policy / log_every << " ("
+                      << (absl::Now() - start) << ")";
+            loss = {};
+          }
+        }
+      });
+    }
+
+    santorini::Batcher batcher(absl::GetFlag(FLAGS_batch_size), &queue);
+    const int64_t num_records =
+        santorini::ReadEpoch(inputs, absl::GetFlag(FLAGS_shuffle_buffer),
+                             &rng, &batcher);
+    batcher.Flush();
+    queue.Close();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    LOG(INFO) << "Epoch " << epoch << " done: " << num_records
+              << " records in " << num_batches << " batches ("
+              << (absl::Now() - start) << ")";
+    if (num_batches == 0) {
+      LOG(ERROR) << "No training examples in --input";
+      return 1;
+    }
+    if (!network->Save(output)) return 1;
+  }
+  LOG(INFO) << "Wrote " << output;
+  return 0;
+}
@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+"""Runs the benchmark suite and compares it against a recorded baseline.
+
+The suite is the speed benchmarks of game/ and ai/, listed in SUITE below.
+Each benchmark runs --repetitions times, and is summarized by the median and
+the coefficient of variation (CV, the standard deviation over the mean) of
+its time per iteration: CPU time, or real time for benchmarks timed in real
+time.
+
+A benchmark counts as changed when its median moves by more than the larger
+of --threshold and --noise_factor times the larger CV of the two runs, so
+that noisy benchmarks need a bigger change. Benchmarks whose CV is above
+--max_cv in either run are reported as noisy instead of changed.
+
+Run from the workspace root, on a quiet machine:
+
+  # Record a baseline, after a deliberate change or on a new machine.
+  $ tools/benchmarks.py update
+
+  # Compare against the baseline. Exits with 1 on regressions.
+  $ tools/benchmarks.py compare
+
+  # Save results to compare later, or compare two saved results.
+  $ tools/benchmarks.py run --out=/tmp/before.json
+  $ tools/benchmarks.py compare --baseline=/tmp/before.json \\
+      --results=/tmp/after.json
+
+The baseline is only meaningful on the machine it was recorded on, which it
+records in its "context", so none is checked in until there is a reference
+machine to record it on. Results from a debug build of the benchmark
+library are refused: their times say little about an optimized build.
+
+Baseline format (tools/benchmark_baseline.json):
+
+  {
+    "format": 1,
+    "context": {host_name, num_cpus, mhz_per_cpu, date, ...},
+    "repetitions": 5,
+    "benchmarks": {
+      "<target>": {
+        "<benchmark name>": {
+          "metric": "cpu_time" or "real_time",
+          "time_unit": "ns", "us", "ms" or "s",
+          "median": <time per iteration, in time_unit>,
+          "cv": <coefficient of variation>,
+          "samples": [<time per iteration of each repetition>, ...]
+        }, ...
+      }, ...
+    }
+  }
+"""
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+BASELINE_FORMAT = 1
+DEFAULT_BASELINE = os.path.join(os.path.dirname(__file__),
+                                'benchmark_baseline.json')
+
+# The benchmark targets of the suite, with a --benchmark_filter regex for
+# each. The thread-scaling, memory and playing strength benchmarks are left
+# out: they measure the machine or the engine's play rather than speed.
+SUITE = [
+    ('//game:board_benchmark', '.'),
+    ('//game:game_runner_benchmark', '.'),
+    ('//ai:mcts_benchmark', 'BM_ExpandNode|BM_Iteration|BM_SelectMove/1000/'),
+    ('//ai:nnue_benchmark', 'BM_StaticEvaluate|BM_Nnue'),
+    ('//ai:alpha_beta_benchmark', 'BM_TimeToDepth/1/'),
+]
+
+TIME_UNITS = {'ns': 1e-9, 'us': 1e-6, 'ms': 1e-3, 's': 1.0}
+
+
+def binary_path(bin_dir, target):
+  package, name = target.lstrip('/').split(':')
+  return os.path.join(bin_dir, package, name)
+
+
+def run_target(args, target, benchmark_filter):
+  """Runs one benchmark binary and returns its JSON output."""
+  with tempfile.NamedTemporaryFile(suffix='.json') as out:
+    command = [
+        binary_path(args.bin_dir, target),
+        '--benchmark_filter=' + (args.filter or benchmark_filter),
+        '--benchmark_repetitions=%d' % args.repetitions,
+        '--benchmark_enable_random_interleaving=true',
+        '--benchmark_out=' + out.name,
+        '--benchmark_out_format=json',
+    ]
+    if args.min_time:
+      command.append('--benchmark_min_time=' + args.min_time)
+    print('Running %s' % target, file=sys.stderr)
+    # Benchmarks read their positions relative to the workspace root.
+    subprocess.run(command, check=True, stdout=subprocess.DEVNULL)
+    return json.load(out)
+
+
+def summarize(output):
+  """Groups the repetitions of each benchmark in `output`."""
+  benchmarks = {}
+  for run in output['benchmarks']:
+    if run.get('run_type') != 'iteration' or 'error_occurred' in run:
+      continue
+    metric = 'real_time' if run['run_name'].endswith('/real_time') else (
+        'cpu_time')
+    entry = benchmarks.setdefault(run['run_name'], {
+        'metric': metric,
+        'time_unit': run['time_unit'],
+        'samples': [],
+    })
+    entry['samples'].append(run[metric])
+  for entry in benchmarks.values():
+    samples = entry['samples']
+    mean = statistics.fmean(samples)
+    entry['median'] = statistics.median(samples)
+    entry['cv'] = (statistics.stdev(samples) / mean
+                   if len(samples) > 1 and mean > 0 else 0.0)
+  return benchmarks
+
+
+def run_suite(args):
+  if not args.no_build:
+    subprocess.run(['bazel', 'build', '-c', 'opt'] +
+                   [target for target, _ in SUITE], check=True)
+  results = {
+      'format': BASELINE_FORMAT,
+      'repetitions': args.repetitions,
+      'benchmarks': {},
+  }
+  for target, benchmark_filter in SUITE:
+    if args.targets and target not in args.targets:
+      continue
+    output = run_target(args, target, benchmark_filter)
+    results.setdefault('context', {
+        key: output['context'].get(key)
+        for key in ('date', 'host_name', 'num_cpus', 'mhz_per_cpu',
+                    'cpu_scaling_enabled', 'library_build_type')
+    })
+    results['benchmarks'][target] = summarize(output)
+  return results
+
+
+def load(path):
+  if not os.path.exists(path):
+    sys.exit('%s does not exist; record it with "tools/benchmarks.py update".' %
+             path)
+  with open(path) as f:
+    results = json.load(f)
+  if results.get('format') != BASELINE_FORMAT:
+    sys.exit('%s: unknown format %r' % (path, results.get('format')))
+  return results
+
+
+def check_release(results, name):
+  """Exits if `results` were measured with a debug benchmark library."""
+  if results.get('context', {}).get('library_build_type') == 'debug':
+    sys.exit('The %s was measured with a debug build of the benchmark '
+             'library, so its times are not comparable. Record it again '
+             'with -c opt.' % name)
+
+
+def save(results, path):
+  with open(path, 'w') as f:
+    json.dump(results, f, indent=1, sort_keys=True)
+    f.write('\n')
+  print('Wrote %s' % path, file=sys.stderr)
+
+
+def format_time(value, unit):
+  seconds = value * TIME_UNITS[unit]
+  for name in ('s', 'ms', 'us', 'ns'):
+    if seconds >= TIME_UNITS[name] or name == 'ns':
+      return '%.4g %s' % (seconds / TIME_UNITS[name], name)
+
+
+def compare(baseline, results, args):
+  """Prints a report of `results` against `baseline`. Returns the number of
+  regressions."""
+  for key in ('host_name', 'num_cpus', 'mhz_per_cpu'):
+    if baseline.get('context', {}).get(key) != results.get('context',
+                                                           {}).get(key):
+      print('Warning: %s differs from the baseline (%s vs %s), so times may '
+            'not be comparable.' %
+            (key, results.get('context', {}).get(key),
+             baseline.get('context', {}).get(key)))
+
+  rows = {'regression': [], 'improvement': [], 'noisy': [], 'unchanged': []}
+  missing = []
+  for target, benchmarks in sorted(baseline['benchmarks'].items()):
+    current_benchmarks = results['benchmarks'].get(target)
+    if current_benchmarks is None:
+      continue
+    for name, base in sorted(benchmarks.items()):
+      current = current_benchmarks.get(name)
+      if current is None:
+        missing.append('%s %s' % (target, name))
+        continue
+      base_seconds = base['median'] * TIME_UNITS[base['time_unit']]
+      seconds = current['median'] * TIME_UNITS[current['time_unit']]
+      change = seconds / base_seconds - 1 if base_seconds > 0 else 0.0
+      noise = max(base['cv'], current['cv'])
+      threshold = max(args.threshold, args.noise_factor * noise)
+      if noise > args.max_cv:
+        kind = 'noisy'
+      elif change > threshold:
+        kind = 'regression'
+      elif change < -threshold:
+        kind = 'improvement'
+      else:
+        kind = 'unchanged'
+      rows[kind].append(
+          (target, name, format_time(base['median'], base['time_unit']),
+           format_time(current['median'], current['time_unit']), change,
+           noise, threshold))
+
+  titles = {
+      'regression': 'Regressions',
+      'improvement': 'Improvements',
+      'noisy': 'Too noisy to judge',
+      'unchanged': 'Unchanged',
+  }
+  for kind, title in titles.items():
+    if not rows[kind] or (kind == 'unchanged' and not args.verbose):
+      continue
+    print('\n%s (%d):' % (title, len(rows[kind])))
+    print('  %-52s %11s %11s %8s %6s %6s' %
+          ('benchmark', 'baseline', 'current', 'change', 'cv', 'limit'))
+    for target, name, base, current, change, noise, threshold in rows[kind]:
+      print('  %-52s %11s %11s %+7.1f%% %5.1f%% %5.1f%%' %
+            (target.split(':')[1] + ' ' + name, base, current, 100 * change,
+             100 * noise, 100 * threshold))
+  if missing:
+    print('\nMissing from the results (%d):' % len(missing))
+    for name in missing:
+      print('  ' + name)
+  print('\n%d regressions, %d improvements, %d noisy, %d unchanged.' %
+        (len(rows['regression']), len(rows['improvement']),
+         len(rows['noisy']), len(rows['unchanged'])))
+  return len(rows['regression'])
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('command', choices=['run', 'compare', 'update'])
+  parser.add_argument('--baseline', default=DEFAULT_BASELINE,
+                      help='Baseline to compare against or update.')
+  parser.add_argument('--results',
+                      help='Compare these saved results instead of running '
+                      'the suite.')
+  parser.add_argument('--out', help='Where "run" writes its results.')
+  parser.add_argument('--repetitions', type=int, default=5)
+  parser.add_argument('--min_time',
+                      help='Passed on as --benchmark_min_time.')
+  parser.add_argument('--targets', nargs='*',
+                      help='Only run these targets of the suite.')
+  parser.add_argument('--filter',
+                      help='Override the --benchmark_filter of every target.')
+  parser.add_argument('--bin_dir', default='bazel-bin',
+                      help='Where the benchmark binaries are built.')
+  parser.add_argument('--no_build', action='store_true',
+                      help='Run the binaries in --bin_dir as they are.')
+  parser.add_argument('--threshold', type=float, default=0.05,
+                      help='Smallest relative change of the median to report.')
+  parser.add_argument('--noise_factor', type=float, default=3.0,
+                      help='A change must also exceed this many CVs.')
+  parser.add_argument('--max_cv', type=float, default=0.1,
+                      help='Benchmarks noisier than this are not judged.')
+  parser.add_argument('--verbose', action='store_true',
+                      help='Also list unchanged benchmarks.')
+  args = parser.parse_args()
+  if args.repetitions < 2:
+    sys.exit('--repetitions must be at least 2 to estimate noise.')
+
+  if args.command == 'compare':
+    baseline = load(args.baseline)
+    check_release(baseline, 'baseline')
+    results = load(args.results) if args.results else run_suite(args)
+    check_release(results, 'results')
+    return 1 if compare(baseline, results, args) > 0 else 0
+  results = run_suite(args)
+  if args.command == 'update':
+    check_release(results, 'baseline')
+    save(results, args.baseline)
+  elif args.out:
+    save(results, args.out)
+  else:
+    json.dump(results, sys.stdout, indent=1, sort_keys=True)
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())